@@ -0,0 +1,67 @@
+// Replaces snmalloc's operator new and delete (override/new.cc) in a
+// USE_ALLOC_PROFILE build, charging every allocation to the current behaviour tag
+// (util/allocs.h) before handing it to snmalloc, so the allocator being profiled
+// is the one used in every other build. The runtime's own allocations, cowns and
+// behaviour closures among them, go to snmalloc directly and are not counted.
+#ifdef USE_ALLOC_PROFILE
+
+#include <snmalloc/snmalloc.h>
+#include <new>
+#include "util/allocs.h"
+
+using namespace snmalloc;
+
+namespace {
+
+void* allocate(size_t size) {
+  allocs::record(size);
+  return ThreadAlloc::get().alloc(size);
+}
+
+void* allocate(size_t size, std::align_val_t alignment) {
+  return allocate(aligned_size((size_t)alignment, size));
+}
+
+void* allocate_or_throw(size_t size) {
+  void* p = allocate(size);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* allocate_or_throw(size_t size, std::align_val_t alignment) {
+  void* p = allocate(size, alignment);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void deallocate(void* p) {
+  ThreadAlloc::get().dealloc(p);
+}
+
+};
+
+void* operator new(size_t size) { return allocate_or_throw(size); }
+void* operator new[](size_t size) { return allocate_or_throw(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocate_or_throw(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocate_or_throw(size, alignment); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(size, alignment); }
+
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p); }
+
+#endif
@@ -2,10 +2,21 @@
 
 #include "examples/leader_ring.h"
 #include "examples/leader_ring_boc.h"
+#include "examples/leader_ring_window.h"
+#include "examples/leader_ring_slab.h"
 #include "examples/leader_tree.h"
 #include "examples/leader_arbitrary.h"
+#include "examples/leader_echo.h"
+#include "examples/leader_generic.h"
+#include "examples/mailbox_bench.h"
+#include "examples/mailbox_delivery.h"
 #include "examples/breakfast.h"
 #include "examples/breakfast_ideal.h"
+#include "examples/kitchen.h"
+#include "examples/bell_fanout.h"
+#include "examples/latch_contention.h"
+#include "examples/open_loop.h"
+#include "examples/leader_ring_layout.h"
 #include "examples/timed/timed.h"
 
 #include <algorithm>
@@ -34,21 +45,89 @@ int main(const int argc, const char** argv) {
 
   size_t servers = benchmarker.opt.is<size_t>("--servers", 100);
   size_t divisions = benchmarker.opt.is<size_t>("--divisions", 5);
+  size_t shards = benchmarker.opt.is<size_t>("--shards", 0);
+
+  topology::Spec shape;
+  shape.shape = benchmarker.opt.is("--topology", "arbitrary");
+  shape.nodes = servers;
+  shape.extra_edges = divisions;
+  shape.degree = benchmarker.opt.is<size_t>("--degree", 4);
+  shape.rewire = std::stod(benchmarker.opt.is("--rewire", "0.1"));
+  shape.seed = BenchmarkHarness::get_seed();
 
   servers = benchmarker.opt.is<size_t>("--bacon", servers);
   divisions = benchmarker.opt.is<size_t>("--eggs", divisions);
 
   if (benchmarker.opt.has("--leader_ring")) 
-    RUN(jake_benchmark::LeaderRing, servers, divisions);
+    RUN(jake_benchmark::LeaderRing, servers, divisions, shards);
+
+  if (benchmarker.opt.has("--leader_ring_slab"))
+    RUN(jake_benchmark::LeaderRingSlab, servers, divisions);
   
+  if (benchmarker.opt.has("--layout")) {
+    RUN(jake_benchmark::LeaderRingLayout<layout::Packed>, servers, divisions);
+    RUN(jake_benchmark::LeaderRingLayout<layout::Padded>, servers, divisions);
+    RUN(jake_benchmark::LeaderRingLayout<layout::Split>, servers, divisions);
+  }
+
   if (benchmarker.opt.has("--leader_ring_boc")) 
     RUN(jake_benchmark::LeaderRingBoC, servers, divisions);
 
+  if (benchmarker.opt.has("--leader_ring_window")) {
+    // a window needs K distinct nodes, so windows wider than the ring are skipped
+    auto fits = [&](size_t k) {
+      if (servers >= k)
+        return true;
+      std::cerr << "WARNING: skipping leader_ring_window_" << k << ", it needs at least " << k << " servers" << std::endl;
+      return false;
+    };
+    if (fits(2))
+      RUN(jake_benchmark::LeaderRingWindow<2>, servers, divisions);
+    if (fits(4))
+      RUN(jake_benchmark::LeaderRingWindow<4>, servers, divisions);
+    if (fits(8))
+      RUN(jake_benchmark::LeaderRingWindow<8>, servers, divisions);
+    if (fits(16))
+      RUN(jake_benchmark::LeaderRingWindow<16>, servers, divisions);
+  }
+
   if (benchmarker.opt.has("--leader_tree"))
     RUN(jake_benchmark::LeaderTree, servers, divisions);
 
   if (benchmarker.opt.has("--leader_arbitrary"))
-    RUN(jake_benchmark::LeaderArbitrary, servers, divisions);
+    RUN(jake_benchmark::LeaderArbitrary, shape, shards);
+
+  if (benchmarker.opt.has("--leader_echo"))
+    RUN(jake_benchmark::LeaderEcho, shape);
+
+  if (benchmarker.opt.has("--leader_echo_boc"))
+    RUN(jake_benchmark::LeaderEchoBoC, shape);
+
+  if (benchmarker.opt.has("--leader_generic")) {
+    using namespace election;
+    using namespace jake_benchmark::leader_generic;
+    using RingActor = jake_benchmark::LeaderGeneric<Ring, ChangRoberts, Actor>;
+    using RingBoC = jake_benchmark::LeaderGeneric<Ring, ChangRoberts, BoC>;
+    using EchoActor = jake_benchmark::LeaderGeneric<Mesh, EchoExtinction, Actor>;
+    using EchoBoC = jake_benchmark::LeaderGeneric<Mesh, EchoExtinction, BoC>;
+    RUN(RingActor, shape);
+    RUN(RingBoC, shape);
+    RUN(EchoActor, shape);
+    RUN(EchoBoC, shape);
+  }
+
+  if (benchmarker.opt.has("--mailbox")) {
+    size_t messages = benchmarker.opt.is<size_t>("--messages", 100000);
+    using namespace jake_benchmark::mailbox_bench;
+    RUN(jake_benchmark::MailboxBench<Legacy>, servers, messages);
+    RUN(jake_benchmark::MailboxBench<Typed>, servers, messages);
+  }
+
+  if (benchmarker.opt.has("--mailbox_delivery")) {
+    using namespace jake_benchmark::mailbox_delivery;
+    RUN(jake_benchmark::MailboxDelivery<Polling>, servers, divisions);
+    RUN(jake_benchmark::MailboxDelivery<EventDriven>, servers, divisions);
+  }
 
   if (benchmarker.opt.has("--breakfast"))
     RUN(jake_benchmark::Breakfast);
@@ -56,7 +135,79 @@ int main(const int argc, const char** argv) {
   if (benchmarker.opt.has("--breakfast_ideal"))
     RUN(jake_benchmark::BreakfastIdeal, servers, divisions);
 
-  if (benchmarker.opt.has("--timed"))
-    RUN(jake_benchmark::TimedBench, servers, divisions);
+  if (benchmarker.opt.has("--breakfast_ideal_polling"))
+    RUN(jake_benchmark::BreakfastIdealPolling, servers, divisions);
+
+  if (benchmarker.opt.has("--kitchen")) {
+    jake_benchmark::kitchen::Config kitchen;
+    kitchen.orders = benchmarker.opt.is<size_t>("--orders", 1000);
+    kitchen.pans = benchmarker.opt.is<size_t>("--pans", 4);
+    kitchen.pan_capacity = benchmarker.opt.is<size_t>("--pan_capacity", 4);
+    kitchen.toasters = benchmarker.opt.is<size_t>("--toasters", 2);
+    kitchen.arrival_ms = std::stod(benchmarker.opt.is("--arrival_ms", "2000"));
+    kitchen.seed = BenchmarkHarness::get_seed();
+    // Orders are seconds apart in simulated time, so on the real clock a rep takes
+    // about half an hour: run on the virtual clock unless asked not to.
+    timer::set_virtual(!benchmarker.opt.has("--real-clock"));
+    RUN(jake_benchmark::Kitchen, kitchen);
+    timer::set_virtual(benchmarker.opt.has("--virtual-clock"));
+  }
+
+  if (benchmarker.opt.has("--bell")) {
+    RUN(jake_benchmark::BellFanout<1>);
+    RUN(jake_benchmark::BellFanout<10>);
+    RUN(jake_benchmark::BellFanout<100>);
+    RUN(jake_benchmark::BellFanout<1000>);
+    RUN(jake_benchmark::BellFanout<10000>);
+  }
+
+  if (benchmarker.opt.has("--latch")) {
+    using namespace jake_benchmark::latch_contention;
+    using CownLatch = jake_benchmark::LatchContention<CownCounter>;
+    using TreeLatch = jake_benchmark::LatchContention<ShardedLatch>;
+    size_t arrivals = benchmarker.opt.is<size_t>("--arrivals", 1000);
+    RUN(CownLatch, servers, arrivals);
+    RUN(TreeLatch, servers, arrivals);
+  }
+
+  if (benchmarker.opt.has("--open_loop")) {
+    using namespace jake_benchmark::open_loop;
+    using KeyValueLoad = jake_benchmark::OpenLoop<KeyValue>;
+    using ElectionLoad = jake_benchmark::OpenLoop<RingElection>;
+    using OrderLoad = jake_benchmark::OpenLoop<BreakfastOrder>;
+    std::string target = benchmarker.opt.is("--target", "kv");
+    load::Schedule schedule;
+    schedule.rate = std::stod(benchmarker.opt.is("--rate", "10000"));
+    schedule.poisson = benchmarker.opt.has("--poisson");
+    schedule.requests = benchmarker.opt.is<size_t>("--requests", 100000);
+    schedule.seed = BenchmarkHarness::get_seed();
+    // With --rate_sweep the rate doubles up to --max_rate; the achieved rate stops
+    // following the offered one at the saturation throughput.
+    double max_rate = benchmarker.opt.has("--rate_sweep") ? std::stod(benchmarker.opt.is("--max_rate", "1000000")) : schedule.rate;
+    for (; schedule.rate <= max_rate; schedule.rate *= 2) {
+      if (target == "kv")
+        RUN(KeyValueLoad, KeyValue(servers), schedule);
+      if (target == "election")
+        RUN(ElectionLoad, RingElection(servers), schedule);
+      if (target == "orders") {
+        jake_benchmark::kitchen::Config kitchen;
+        kitchen.pans = benchmarker.opt.is<size_t>("--pans", 4);
+        kitchen.pan_capacity = benchmarker.opt.is<size_t>("--pan_capacity", 4);
+        kitchen.toasters = benchmarker.opt.is<size_t>("--toasters", 2);
+        kitchen.seed = schedule.seed;
+        // latency is measured on the real clock, so the cooking has to be too
+        timer::set_virtual(false);
+        RUN(OrderLoad, BreakfastOrder(kitchen), schedule);
+        timer::set_virtual(benchmarker.opt.has("--virtual-clock"));
+      }
+    }
+  }
+
+  // Actor against BoC on one ring, with alternating runs paired up; --reps is the
+  // number of pairs.
+  if (benchmarker.opt.has("--timed")) {
+    jake_benchmark::timed::Ring ring(servers);
+    benchmarker.run_paired<jake_benchmark::TimedActor, jake_benchmark::TimedBoC>(ring);
+  }
 
 }
\ No newline at end of file
@@ -0,0 +1,186 @@
+#ifndef ELECTION_H
+#define ELECTION_H
+
+#include <cpp/when.h>
+#include <array>
+#include <vector>
+#include "util/counter.h"
+#include "util/topology.h"
+
+// A framework for leader elections where the topology, the algorithm and the
+// paradigm are all template parameters, so everything is resolved at compile time
+// and an algorithm's handlers are inlined straight into the behaviour bodies.
+//
+//  - a Topology says how a node stores its links and how they are read off a graph,
+//  - an Algorithm supplies the per-node State<Node>, the Message type and the
+//    on_start / on_message hooks, written against a Context,
+//  - a Paradigm decides how a message is delivered: as a behaviour on the receiver
+//    (actor) or as a behaviour on both sender and receiver (BoC).
+namespace election {
+
+using namespace verona::cpp;
+
+typedef enum {
+    Leader,
+    Follower,
+    Candidate
+} State;
+
+// Each node only knows its successor, taken from the graph's neighbour list as the
+// next node around the ring.
+struct Ring {
+    template <typename Ptr>
+    using Links = std::array<Ptr, 1>;
+
+    static topology::Graph graph(topology::Spec spec) {
+        spec.shape = "ring";
+        return topology::generate(spec);
+    }
+
+    template <typename Ptr>
+    static Links<Ptr> links(const topology::Graph & graph, uint64_t i, const std::vector<Ptr> & nodes) {
+        return { nodes[(i + 1) % graph.nodes()] };
+    }
+};
+
+// Each node knows all of its neighbours in the graph.
+struct Mesh {
+    template <typename Ptr>
+    using Links = std::vector<Ptr>;
+
+    static topology::Graph graph(const topology::Spec & spec) {
+        return topology::generate(spec);
+    }
+
+    template <typename Ptr>
+    static Links<Ptr> links(const topology::Graph & graph, uint64_t i, const std::vector<Ptr> & nodes) {
+        Links<Ptr> links;
+        links.reserve(graph.degree(i));
+        for (const uint64_t* t = graph.begin(i); t != graph.end(i); t++)
+            links.push_back(nodes[*t]);
+        return links;
+    }
+};
+
+template <typename Node>
+struct Context;
+
+// A message is a behaviour on the receiver alone.
+struct Actor {
+    static constexpr const char* name = "actor";
+
+    template <typename Node>
+    static void deliver(const cown_ptr<Node> & from, const cown_ptr<Node> & to, typename Node::Message msg) {
+        when (to) << [=](acquired_cown<Node> node) {
+            Context<Node> ctx(to, *node, from, nullptr);
+            Node::Algorithm::on_message(ctx, msg);
+        };
+    }
+};
+
+// A message is a behaviour on both sender and receiver, so the receiver's handler
+// can also read the sender's current state through Context::sender.
+struct BoC {
+    static constexpr const char* name = "boc";
+
+    template <typename Node>
+    static void deliver(const cown_ptr<Node> & from, const cown_ptr<Node> & to, typename Node::Message msg) {
+        if (from == to) {
+            Actor::deliver(from, to, msg);
+            return;
+        }
+        when (from, to) << [=](acquired_cown<Node> sender, acquired_cown<Node> node) {
+            Context<Node> ctx(to, *node, from, &*sender);
+            Node::Algorithm::on_message(ctx, msg);
+        };
+    }
+};
+
+template <typename Topology, typename Alg, typename Paradigm>
+struct ElectionNode {
+    using Algorithm = Alg;
+    using Message = typename Algorithm::Message;
+    using Links = typename Topology::template Links<cown_ptr<ElectionNode>>;
+    using AlgorithmState = typename Algorithm::template State<ElectionNode>;
+
+    static inline ShardedCounter messages;
+
+    uint64_t id;
+    State state = Follower;
+    Links links;
+    AlgorithmState algorithm;
+
+    ElectionNode(uint64_t id): id(id), algorithm(id) {}
+
+    static void set_links(const cown_ptr<ElectionNode> & self, Links links) {
+        when (self) << [links = std::move(links)](acquired_cown<ElectionNode> node) mutable {
+            node->links = std::move(links);
+        };
+    }
+
+    static void start(const cown_ptr<ElectionNode> & self) {
+        when (self) << [=](acquired_cown<ElectionNode> node) {
+            Context<ElectionNode> ctx(self, *node, cown_ptr<ElectionNode>(), nullptr);
+            Algorithm::on_start(ctx);
+        };
+    }
+
+    static void send(const cown_ptr<ElectionNode> & from, const cown_ptr<ElectionNode> & to, Message msg) {
+        messages.add();
+        Paradigm::deliver(from, to, msg);
+    }
+};
+
+// What an algorithm's hooks see: the node they run on, who sent the message being
+// handled (null in on_start), and, under BoC, the sender's state.
+template <typename Node>
+struct Context {
+    cown_ptr<Node> self;
+    Node & node;
+    cown_ptr<Node> from;
+    Node * sender;
+
+    Context(cown_ptr<Node> self, Node & node, cown_ptr<Node> from, Node * sender):
+        self(self), node(node), from(from), sender(sender) {}
+
+    uint64_t id() const { return node.id; }
+
+    typename Node::AlgorithmState & state() { return node.algorithm; }
+
+    size_t degree() const { return node.links.size(); }
+
+    void set_state(State s) { node.state = s; }
+
+    void send(size_t link, typename Node::Message msg) {
+        Node::send(self, node.links[link], msg);
+    }
+
+    void reply(typename Node::Message msg) {
+        Node::send(self, from, msg);
+    }
+
+    void send_to(const cown_ptr<Node> & to, typename Node::Message msg) {
+        Node::send(self, to, msg);
+    }
+
+    void broadcast(typename Node::Message msg) {
+        for (auto const& link : node.links)
+            Node::send(self, link, msg);
+    }
+
+    // Sends to every link except one of those leading back to `except`.
+    void broadcast_except(const cown_ptr<Node> & except, typename Node::Message msg) {
+        bool skipped = false;
+        for (auto const& link : node.links) {
+            if (!skipped && link == except) {
+                skipped = true;
+                continue;
+            }
+            Node::send(self, link, msg);
+        }
+    }
+};
+
+};
+
+#endif // ELECTION_H
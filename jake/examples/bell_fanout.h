@@ -0,0 +1,56 @@
+#include "util/bench.h"
+#include "util/bell.h"
+#include "../safe_print.h"
+#include <atomic>
+#include <chrono>
+
+namespace jake_benchmark {
+
+// One producer waking N consumers: N subscribers await a bell, it is rung once,
+// and every subscriber records how long after the notify it was called.
+template <size_t N>
+struct BellFanout: public ActorBenchmark {
+    static const inline std::string name = "bell_fanout_" + std::to_string(N);
+
+    using Clock = std::chrono::steady_clock;
+    using Bell = event::Bell<Clock::time_point>;
+
+    std::atomic<uint64_t> called{0};
+    std::atomic<int64_t> total_ns{0};
+    std::atomic<int64_t> last_ns{0};
+
+    BellFanout() {}
+
+    void run() {
+        called = 0;
+        total_ns = 0;
+        last_ns = 0;
+        cown_ptr<Bell> bell = make_cown<Bell>();
+        for (size_t i = 0; i < N; i++) {
+            Bell::await(bell, [this](Clock::time_point rung) {
+                int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - rung).count();
+                total_ns += ns;
+                int64_t last = last_ns;
+                while (last < ns && !last_ns.compare_exchange_weak(last, ns));
+                called++;
+            });
+        }
+        // The bell's behaviours run in order, so every await is in before the notify.
+        when (bell) << [bell](acquired_cown<Bell>) {
+            Bell::notify(bell, Clock::now());
+        };
+    }
+
+    // The last subscriber's latency is how long the whole fan-out took.
+    std::vector<std::pair<std::string, double>> metrics() {
+        double n = (double)called;
+        double last_us = last_ns / 1e3;
+        return {
+            {"mean_latency_us", n > 0 ? total_ns / n / 1e3 : 0},
+            {"fan_out_us", last_us},
+            {"subscribers_per_s", last_us > 0 ? n / (last_us / 1e6) : 0}
+        };
+    }
+};
+
+};
@@ -3,21 +3,24 @@
 #include "../typecheck.h"
 #include "../safe_print.h"
 #include "../rng.h"
+#include "util/timer.h"
 #include <map>
-#include <unistd.h>
 #include <stdexcept>
 
-#define MICROSECS 1000000
-
 namespace jake_benchmark {
 
 namespace breakfast {
 
+    using namespace std::chrono_literals;
+
+    // Cooking happens on the timer, so the cowns are free while food is on the heat and
+    // anything that needs the finished food waits with timer::when_idle.
     struct Bread {
         int slices;
         Bread(int slices): slices(slices) {}
-        static const int toast_time = 8;
+        static constexpr auto toast_time = 8s;
         bool toasted = false;
+        timer::Busy<Bread> busy;
 
         void add_jam() {
             debug("Added jam to toast");
@@ -31,9 +34,10 @@ namespace breakfast {
                     for (int i = 0; i < bread->slices; i++)
                         debug("Putting a slice of bread in the toaster");
                     debug("Begin toasting");
-                    usleep(Bread::toast_time * MICROSECS);
-                    bread->toasted = true;
-                    debug("Remove toast from toaster");
+                    timer::busy_for(bread, Bread::toast_time, [](acquired_cown<Bread> & bread) {
+                        bread->toasted = true;
+                        debug("Remove toast from toaster");
+                    });
                 }
                 else {
                     throw std::runtime_error("Burned toast!");
@@ -57,17 +61,19 @@ namespace breakfast {
     struct Bacon {
         int count;
         Bacon(int count): count(count) {}
-        static const int cook_time = 10;
+        static constexpr auto cook_time = 10s;
+        timer::Busy<Bacon> busy;
         
         static void fry(const cown_ptr<Bacon> & bacon) {
-            when (bacon) << [=](auto bacon) {
+            when (bacon) << [=](acquired_cown<Bacon> bacon) {
                 debug("Putting ", bacon->count, " slices of bacon in the pan");
                 debug("Cooking first side of bacon");
-                usleep(Bacon::cook_time * MICROSECS);
-                for (int i = 0; i < bacon->count; i++) 
-                    debug("Flipping a side of bacon");
-                debug("Cooking second side of bacon");
-                usleep(Bacon::cook_time * MICROSECS);
+                timer::busy_for(bacon, Bacon::cook_time, [](acquired_cown<Bacon> & bacon) {
+                    for (int i = 0; i < bacon->count; i++) 
+                        debug("Flipping a side of bacon");
+                    debug("Cooking second side of bacon");
+                    timer::busy_for(bacon, Bacon::cook_time, [](acquired_cown<Bacon> &) {});
+                });
             };
         }
     };
@@ -76,26 +82,43 @@ namespace breakfast {
     struct Egg {
         int count;
         Egg(int count): count(count) {}
-        static const int cook_time = 5;
+        static constexpr auto cook_time = 5s;
+        timer::Busy<Egg> busy;
         
         static void fry(const cown_ptr<Egg> & egg) {
-            when (egg) << [=](auto egg) {
+            when (egg) << [=](acquired_cown<Egg> egg) {
                 debug("Warming the egg pan");
-                usleep(Egg::cook_time * MICROSECS);
-                debug("Cracking ", egg->count, " eggs");
-                debug("Cooking the eggs");
-                usleep(Egg::cook_time * MICROSECS);
+                timer::busy_for(egg, Egg::cook_time, [](acquired_cown<Egg> & egg) {
+                    debug("Cracking ", egg->count, " eggs");
+                    debug("Cooking the eggs");
+                    timer::busy_for(egg, Egg::cook_time, [](acquired_cown<Egg> &) {});
+                });
             };
         }
     };
+
+    // Schedules `then` once `food` has finished cooking.
+    template <typename T, typename F>
+    void when_cooked(const cown_ptr<T> & food, F then) {
+        when (food) << [=](acquired_cown<T> food) {
+            timer::when_idle(food, [=](acquired_cown<T> & food) { then(food); });
+        };
+    }
 };
 
 struct Breakfast : public ActorBenchmark {
+    static const inline std::string name = "breakfast";
+
+    timer::Clock::time_point begin;
+    double makespan_s = 0;
+    double wall_ms = 0;
 
     Breakfast() {}
 
     void run() {
         using namespace breakfast;
+        timer::reset();
+        begin = timer::Clock::now();
         when (make_cown<Breakfast>()) << [=](acquired_cown<Breakfast> bk) {
             Coffee();
             debug("Coffee is ready");
@@ -108,29 +131,42 @@ struct Breakfast : public ActorBenchmark {
             Egg::fry(egg);
             Bread::toast(bread);
             
-            when (bread) << [](acquired_cown<Bread> bread) {
+            when_cooked(bread, [](acquired_cown<Bread> & bread) {
                 bread->add_butter();
                 bread->add_jam();
-            };
-
-            when (bread) << [](acquired_cown<Bread> bread) {
                 debug("Toast is ready");
-            };
-            when (egg) << [](acquired_cown<Egg> egg) {
+            });
+            when_cooked(egg, [](acquired_cown<Egg> & egg) {
                 debug("Eggs are ready");
-            };
-            when (bacon) << [](acquired_cown<Bacon> bacon) {
+            });
+            when_cooked(bacon, [](acquired_cown<Bacon> & bacon) {
                 debug("Bacon is ready");
-            };
-
-            when (bread, egg, bacon) << [=](auto bread, auto egg, auto bacon) {
-                Juice();
-                debug("OJ is ready");
-                debug("Finished making breakfast");
-                std::exit(0);
-            };
+            });
+
+            when_cooked(bread, [=](acquired_cown<Bread> &) {
+                when_cooked(egg, [=](acquired_cown<Egg> &) {
+                    when_cooked(bacon, [=](acquired_cown<Bacon> &) {
+                        when (bread, egg, bacon) << [=](auto bread, auto egg, auto bacon) {
+                            Juice();
+                            debug("OJ is ready");
+                            debug("Finished making breakfast");
+                            served();
+                        };
+                    });
+                });
+            });
         };
     }
+
+    // With --virtual-clock the cooking takes no real time, so wall_ms is all overhead.
+    void served() {
+        makespan_s = std::chrono::duration<double>(timer::elapsed()).count();
+        wall_ms = std::chrono::duration<double, std::milli>(timer::Clock::now() - begin).count();
+    }
+
+    std::vector<std::pair<std::string, double>> metrics() {
+        return {{"makespan_s", makespan_s}, {"wall_ms", wall_ms}};
+    }
 };
 
 };
\ No newline at end of file
@@ -1,24 +1,63 @@
+#pragma once
+
 #include "util/bench.h"
 #include "util/random.h"
 #include "../typecheck.h"
 #include "../safe_print.h"
 #include "../rng.h"
+#include "util/timer.h"
+#include "util/join.h"
+#include "util/resource.h"
+#include "util/bell.h"
+#include "util/counter.h"
+#include <atomic>
 #include <map>
-#include <unistd.h>
 #include <stdexcept>
 
-#define MICROSECS 1000000
-
 namespace jake_benchmark {
 
 namespace breakfast_ideal {
 
+    using namespace std::chrono_literals;
+
+    // Everything that takes time is handed to the timer, so no worker is blocked while
+    // food cooks. A cown is free while its operation is in progress, so operations that
+    // must wait for it go through timer::when_idle.
+
     // We use inheritance to make it easy to extend this program
     // e.g. we could add Bagels, which could inherit from Toastable
 
+    // Simulated time at which a food last became ready, in nanoseconds.
+    inline std::atomic<int64_t> last_ready_ns{0};
+    // Behaviours scheduled by BreakfastIdeal::finish_polling.
+    inline ShardedCounter polling_behaviours;
+
     struct Food {
         virtual bool ready() = 0;
         virtual std::string item_name() = 0;
+
+        std::vector<std::function<void()>> waiting_until_ready;
+
+        // Runs `fn` as soon as the food is ready, so nobody has to keep checking.
+        void when_ready(std::function<void()> fn) {
+            if (ready())
+                fn();
+            else
+                waiting_until_ready.push_back(std::move(fn));
+        }
+
+        // Must be called after anything that may have made the food ready.
+        void changed() {
+            if (!ready())
+                return;
+            int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(timer::elapsed()).count();
+            int64_t last = last_ready_ns;
+            while (last < now && !last_ready_ns.compare_exchange_weak(last, now));
+            std::vector<std::function<void()>> waiting;
+            waiting.swap(waiting_until_ready);
+            for (auto & fn : waiting)
+                fn();
+        }
     };
 
     struct Appliance {
@@ -42,33 +81,42 @@ namespace breakfast_ideal {
         bool ready() override {
             return toasted && has_jam && has_butter;
         }
+        timer::Busy<Bread> busy;
         int toast_time() override {
             return 8;
         }
         static void add_jam(cown_ptr<Bread> & self) {
             when (self) << [=](acquired_cown<Bread> self) {
-                debug("Begin adding jam");
-                if (self->toasted) {
-                    usleep(MICROSECS / 4);
-                    self->has_jam = true;
-                    debug("Added jam to toast");
-                }
-                else {
-                    throw std::runtime_error("Cannot add jam to untoasted bread");
-                }
+                timer::when_idle(self, [](acquired_cown<Bread> & self) {
+                    debug("Begin adding jam");
+                    if (self->toasted) {
+                        timer::busy_for(self, 250ms, [](acquired_cown<Bread> & self) {
+                            self->has_jam = true;
+                            self->changed();
+                            debug("Added jam to toast");
+                        });
+                    }
+                    else {
+                        throw std::runtime_error("Cannot add jam to untoasted bread");
+                    }
+                });
             };
         }
         static void add_butter(cown_ptr<Bread> & self) {
             when (self) << [=](acquired_cown<Bread> self) {
-                debug("Begin buttering toast");
-                if (self->toasted) {
-                    usleep(MICROSECS / 4);
-                    self->has_butter = true;
-                    debug("Buttered toast");
-                }
-                else {
-                    throw std::runtime_error("Ewww, buttered raw bread!");
-                }
+                timer::when_idle(self, [](acquired_cown<Bread> & self) {
+                    debug("Begin buttering toast");
+                    if (self->toasted) {
+                        timer::busy_for(self, 250ms, [](acquired_cown<Bread> & self) {
+                            self->has_butter = true;
+                            self->changed();
+                            debug("Buttered toast");
+                        });
+                    }
+                    else {
+                        throw std::runtime_error("Ewww, buttered raw bread!");
+                    }
+                });
             };
         }
     };
@@ -76,6 +124,7 @@ namespace breakfast_ideal {
     struct Cup : public Food {
         bool has_coffee = false;
         bool has_juice = false;
+        timer::Busy<Cup> busy;
         bool ready() override {
             return has_coffee || has_juice;
         }
@@ -90,47 +139,59 @@ namespace breakfast_ideal {
         }
         static void pour_coffee(cown_ptr<Cup> & self) {
             when (self) << [=](acquired_cown<Cup> self) {
-                debug("Begin pouring coffee");
-                if (self->has_coffee || self->has_juice) {
-                    throw std::runtime_error("Full " + self->item_name());
-                }
-                else {
-                    usleep(MICROSECS / 2);
-                    self->has_coffee = true;
-                    debug("Poured coffee");
-                }
+                timer::when_idle(self, [](acquired_cown<Cup> & self) {
+                    debug("Begin pouring coffee");
+                    if (self->has_coffee || self->has_juice) {
+                        throw std::runtime_error("Full " + self->item_name());
+                    }
+                    else {
+                        timer::busy_for(self, 500ms, [](acquired_cown<Cup> & self) {
+                            self->has_coffee = true;
+                            self->changed();
+                            debug("Poured coffee");
+                        });
+                    }
+                });
             };
         }
         static void pour_juice(cown_ptr<Cup> & self) {
             when (self) << [=](acquired_cown<Cup> self) {
-                debug("Begin pouring juice");
-                if (self->has_coffee || self->has_juice) {
-                    throw std::runtime_error("Full " + self->item_name());
-                }
-                else {
-                    usleep(MICROSECS / 2);
-                    self->has_juice = true;
-                    debug("Poured juice");
-                }
+                timer::when_idle(self, [](acquired_cown<Cup> & self) {
+                    debug("Begin pouring juice");
+                    if (self->has_coffee || self->has_juice) {
+                        throw std::runtime_error("Full " + self->item_name());
+                    }
+                    else {
+                        timer::busy_for(self, 500ms, [](acquired_cown<Cup> & self) {
+                            self->has_juice = true;
+                            self->changed();
+                            debug("Poured juice");
+                        });
+                    }
+                });
             };
         }
         static void drink(cown_ptr<Cup> & self) {
             when (self) << [=](acquired_cown<Cup> self) {
-                if (self->has_coffee) {
-                    debug("Begin drinking coffee");
-                    usleep(6 * MICROSECS);
-                    self->has_coffee = false;
-                    debug("Finished drinking coffee");
-                }
-                else if (self->has_juice) {
-                    debug("Begin drinking juice");
-                    usleep(3 * MICROSECS);
-                    self->has_juice = false;
-                    debug("Finished drinking juice");
-                }
-                else {
-                    throw std::runtime_error("Cannot drink from empty cup");
-                }
+                timer::when_idle(self, [](acquired_cown<Cup> & self) {
+                    if (self->has_coffee) {
+                        debug("Begin drinking coffee");
+                        timer::busy_for(self, 6s, [](acquired_cown<Cup> & self) {
+                            self->has_coffee = false;
+                            debug("Finished drinking coffee");
+                        });
+                    }
+                    else if (self->has_juice) {
+                        debug("Begin drinking juice");
+                        timer::busy_for(self, 3s, [](acquired_cown<Cup> & self) {
+                            self->has_juice = false;
+                            debug("Finished drinking juice");
+                        });
+                    }
+                    else {
+                        throw std::runtime_error("Cannot drink from empty cup");
+                    }
+                });
             };
         }
     };
@@ -150,6 +211,7 @@ namespace breakfast_ideal {
 
     struct Bacon : public Fryable {
         int number;
+        timer::Busy<Bacon> busy;
         Bacon(int number): number(number) {
             //debug("made bacon ", number);
         };
@@ -163,6 +225,7 @@ namespace breakfast_ideal {
 
     struct Egg : public Fryable {
         int number;
+        timer::Busy<Egg> busy;
         Egg(int number): number(number) {
             //debug("cracked egg ", number);
         };
@@ -182,110 +245,110 @@ namespace breakfast_ideal {
 
     // Bells are generic so we can use them for other appliances, e.g. microwaves
     template <typename T>
-    struct Bell {
-        std::function<void(T)> queued_callback;
-        static void await(const cown_ptr<Bell<T>> & self, std::function<void(T)> callback) {
-            when (self) << [=](acquired_cown<Bell<T>> self)  {
-                if (self->queued_callback == nullptr) {
-                    self->queued_callback = callback;
-                }
-            };
-        }
-        static void notify(const cown_ptr<Bell<T>> & self, T item) {
-            when (self) << [=](acquired_cown<Bell<T>> self)  {
-                if (self->queued_callback != nullptr) {
-                    self->queued_callback(item);
-                    self->queued_callback = nullptr;
-                }
-            };
-        }
-    };
+    using Bell = event::Bell<T>;
 
     struct Toaster : public Appliance {
         int temperature = 0;
         cown_ptr<Bell<ToastableCown>> bell;
+        timer::Busy<Toaster> busy;
 
         Toaster(cown_ptr<Bell<ToastableCown>> bell): bell(bell) {}
         
+        // The toaster stays busy until the toast comes out, so it toasts one thing at a time.
         static void toast(const cown_ptr<Toaster> & self, ToastableCown item) {
             when (self) << [=](acquired_cown<Toaster> tag) {
-                tag->temperature = std::max(10, tag->temperature + 1);
-                std::visit([=](auto & toastable_cown) {
-                    when (self, toastable_cown) << [=](acquired_cown<Toaster> self, auto toastable) {
-                        if (!toastable->toasted) {
-                            debug("Begin toasting ", toastable->item_name());
-                            usleep(toastable->toast_time() * MICROSECS - self->temperature * 1000);
-                            toastable->toasted = true;
-                            debug("Finished making ", toastable->item_name());
-                            Bell<ToastableCown>::notify(self->bell, toastable_cown);
-                        }
-                        else {
-                            throw std::runtime_error("Burned " + toastable->item_name());
-                        }
-                    };
-                }, item);
+                timer::when_idle(tag, [=](acquired_cown<Toaster> & tag) {
+                    tag->temperature = std::max(10, tag->temperature + 1);
+                    timer::occupy(tag);
+                    std::visit([=](auto & toastable_cown) {
+                        when (self, toastable_cown) << [=](acquired_cown<Toaster> toaster, auto toastable) {
+                            if (!toastable->toasted) {
+                                debug("Begin toasting ", toastable->item_name());
+                                auto time = std::chrono::seconds(toastable->toast_time()) - std::chrono::milliseconds(toaster->temperature);
+                                cown_ptr<Bell<ToastableCown>> bell = toaster->bell;
+                                timer::busy_for(toastable, time, [=](auto & toastable) {
+                                    toastable->toasted = true;
+                                    toastable->changed();
+                                    debug("Finished making ", toastable->item_name());
+                                    Bell<ToastableCown>::notify(bell, toastable_cown);
+                                    when (self) << [](acquired_cown<Toaster> self) {
+                                        timer::idle(self);
+                                    };
+                                });
+                            }
+                            else {
+                                throw std::runtime_error("Burned " + toastable->item_name());
+                            }
+                        };
+                    }, item);
+                });
             };
         }
     };
 
     struct Pan : public Appliance {
         bool warm = false;
-        int capacity;
-        int spaces;
-        std::queue<FryableCown> queue;
-        Pan(int capacity): capacity(capacity), spaces(capacity) {}
+        resource::Capacity<FryableCown> spaces;
+        timer::Busy<Pan> busy;
+        Pan(int capacity): spaces(capacity) {}
 
         static void heat_pan(cown_ptr<Pan> & self) {
             when (self) << [=](acquired_cown<Pan> self) {
-                if (!self->warm) {
-                    debug("Heating pan");
-                    usleep(4 * MICROSECS);
-                    self->warm = true;
-                    debug("Pan is ready");
-                }
+                timer::when_idle(self, [](acquired_cown<Pan> & self) {
+                    if (!self->warm) {
+                        debug("Heating pan");
+                        timer::busy_for(self, 4s, [](acquired_cown<Pan> & self) {
+                            self->warm = true;
+                            debug("Pan is ready");
+                        });
+                    }
+                });
             };
         }
 
+        // Frees a space, which goes straight to the next queued item if there is one.
         static void finish(const cown_ptr<Pan> & self) {
             when (self) << [=](acquired_cown<Pan> self) {
-                self->spaces = std::min(self->capacity, self->spaces + 1);
-                if (!self->queue.empty()) {
-                    Pan::cook_item(self.cown(), self->queue.front());
-                    self->queue.pop();
-                }
+                if (auto next = self->spaces.give_back())
+                    Pan::fry(*next, [pan = self.cown()]() { Pan::finish(pan); });
             };
         }
 
         static void cook_item(const cown_ptr<Pan> & self, FryableCown & item) {
             when (self) << [=](acquired_cown<Pan> tag) {
-                if (tag->warm) {
-                    if (tag->spaces > 0) {
-                        tag->spaces--;
-                        std::visit([=](auto & fryable_cown) {
-                            when (fryable_cown) << [=](auto fryable) {
-                                debug("Begin frying ", fryable->item_name());
-                                usleep(fryable->cook_time() * MICROSECS);
-                                if (!fryable->cooked) {
-                                    fryable->cooked = true;
-                                    debug("Finished frying ", fryable->item_name());
-                                }
-                                else {
-                                    throw std::runtime_error("Burned " + fryable->item_name());
-                                }
-                                Pan::finish(self);
-                            };
-                        }, item);
+                timer::when_idle(tag, [=](acquired_cown<Pan> & tag) {
+                    if (tag->warm) {
+                        if (tag->spaces.take(item))
+                            Pan::fry(item, [self]() { Pan::finish(self); });
+                        else
+                            debug("Pan is full, queueing item");
                     }
                     else {
-                        debug("Pan is full, queueing item");
-                        tag->queue.push(item);
+                        throw std::runtime_error("Cannot cook on cold pan");
                     }
-                }
-                else {
-                    throw std::runtime_error("Cannot cook on cold pan");
-                }
+                });
             };
         }
+
+        // Fries an item that has been given a space, then calls `done` to give the space back.
+        static void fry(const FryableCown & item, std::function<void()> done) {
+            std::visit([=](auto & fryable_cown) {
+                when (fryable_cown) << [=](auto fryable) {
+                    debug("Begin frying ", fryable->item_name());
+                    timer::busy_for(fryable, std::chrono::seconds(fryable->cook_time()), [=](auto & fryable) {
+                        if (!fryable->cooked) {
+                            fryable->cooked = true;
+                            fryable->changed();
+                            debug("Finished frying ", fryable->item_name());
+                        }
+                        else {
+                            throw std::runtime_error("Burned " + fryable->item_name());
+                        }
+                        done();
+                    });
+                };
+            }, item);
+        }
     };
 };
 
@@ -295,35 +358,96 @@ struct Bool {
 };
 
 struct BreakfastIdeal : public ActorBenchmark {
+    static const inline std::string name = "breakfast_ideal";
+
     int bacon_num;
     int egg_num;
-    BreakfastIdeal(int bacon_num, int egg_num): bacon_num(bacon_num), egg_num(egg_num) {}
-    // this is not ideal, I would prefer to be able to acquire all cowns at once, 
-    // but C++ makes it very difficult to turn a vector into a VARARGS list,
-    // especially when each member of the vector is of a different type.
+    bool polling;
+    timer::Clock::time_point begin;
+    double makespan_s = 0;
+    double wall_ms = 0;
+    double latency_ms = 0;
+
+    BreakfastIdeal(int bacon_num, int egg_num, bool polling = false): bacon_num(bacon_num), egg_num(egg_num), polling(polling) {}
+    // Every food arrives at a barrier once it is ready, so nothing is scheduled while
+    // the cooking goes on. A cup can stop being ready again (the coffee gets drunk)
+    // while the rest are still cooking, so everything is checked once more, in one
+    // round, before breakfast is served.
     void finish(std::vector<breakfast_ideal::FoodCown> food) {
+        join::when_all(food, [](auto & item, join::Arrival arrive) {
+            ALLOC_TAG("breakfast_ideal::finish");
+            item->when_ready(arrive);
+        }, [=]() {
+            ALLOC_TAG("breakfast_ideal::finish");
+            auto all_ready = std::make_shared<std::atomic<bool>>(true);
+            join::when_all(food, [=](auto & item, join::Arrival arrive) {
+                if (!item->ready())
+                    *all_ready = false;
+                arrive();
+            }, [=]() {
+                if (*all_ready) {
+                    debug("Finished making breakfast_ideal");
+                    served();
+                }
+                else {
+                    finish(food);
+                }
+            });
+        });
+    }
+
+    // The old way of finishing, kept to compare against: one behaviour per item every
+    // round, and a new round every 100ms until a round finds everything ready.
+    void finish_polling(std::vector<breakfast_ideal::FoodCown> food) {
         using namespace breakfast_ideal;
         cown_ptr<Bool> finished = make_cown<Bool>(true);
         for (auto & f : food) {
             std::visit([=](auto & food_cown) {
+                polling_behaviours.add();
                 when (food_cown, finished) << [=](auto food, auto finished) {
                     finished->value &= food->ready();
                 };
             }, f);
         }
+        polling_behaviours.add();
         when (finished) << [=](acquired_cown<Bool> finished) {
+            ALLOC_TAG("breakfast_ideal::finish_polling");
             if (finished->value) {
                 debug("Finished making breakfast_ideal");
-                std::exit(0);
+                served();
             }
             else {
-                finish(food);
+                timer::after(100ms, [=]() { finish_polling(food); });
             }
         };
     }
 
+    // With --virtual-clock the cooking takes no real time, so wall_ms is all overhead.
+    // latency_ms is the simulated time from the last food becoming ready to serving.
+    void served() {
+        auto elapsed = timer::elapsed();
+        makespan_s = std::chrono::duration<double>(elapsed).count();
+        wall_ms = std::chrono::duration<double, std::milli>(timer::Clock::now() - begin).count();
+        latency_ms = (std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() - breakfast_ideal::last_ready_ns) / 1e6;
+    }
+
+    std::vector<std::pair<std::string, double>> metrics() {
+        double behaviours = (double)(polling ? breakfast_ideal::polling_behaviours.total() : join::behaviours.total());
+        return {
+            {"makespan_s", makespan_s},
+            {"wall_ms", wall_ms},
+            {"finish_behaviours", behaviours},
+            {"completion_latency_ms", latency_ms}
+        };
+    }
+
     void run() {
         using namespace breakfast_ideal;
+        timer::reset();
+        begin = timer::Clock::now();
+        last_ready_ns = 0;
+        breakfast_ideal::polling_behaviours.reset();
+        join::behaviours.reset();
         when (make_cown<BreakfastIdeal>(bacon_num,egg_num)) << [=](acquired_cown<BreakfastIdeal> bk) {
             cown_ptr<Bread> bread = make_cown<Bread>();
             cown_ptr<Cup> cup = make_cown<Cup>();
@@ -364,9 +488,18 @@ struct BreakfastIdeal : public ActorBenchmark {
 
             food.push_back(cup);
             food.push_back(bread);
-            finish(food);
+            if (polling)
+                finish_polling(food);
+            else
+                finish(food);
         };
     }
 };
 
+struct BreakfastIdealPolling : public BreakfastIdeal {
+    static const inline std::string name = "breakfast_ideal_polling";
+
+    BreakfastIdealPolling(int bacon_num, int egg_num): BreakfastIdeal(bacon_num, egg_num, true) {}
+};
+
 };
\ No newline at end of file
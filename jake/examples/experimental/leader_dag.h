@@ -1,5 +1,6 @@
 #include "util/bench.h"
 #include "util/random.h"
+#include "util/latch.h"
 #include "../typecheck.h"
 #include "../safe_print.h"
 #include "../rng.h"
@@ -26,27 +27,6 @@ struct Message {
     Message(uint64_t sender_id, MsgType msg_type): sender_id(sender_id), msg_type(msg_type) {}
 };
 
-template <typename K>
-struct Counter {
-    K remaining;
-    std::function<void()> on_complete;
-
-    Counter(K initial, std::function<void()> cb) : remaining(initial), on_complete(cb) {}
-
-    static void done(cown_ptr<Counter<K>> self) {
-        when(self) << [=](acquired_cown<Counter<K>> self) {
-            if (self->remaining == 0)
-                self->on_complete();
-        };
-    }
-
-    static void add(cown_ptr<Counter<K>> self, K n = 1) {
-        when(self) << [=](acquired_cown<Counter<K>> self) {
-            self->remaining -= n;
-        };
-    }
-};
-
 struct Node;
 
 struct Mailbox {
@@ -188,6 +168,8 @@ void Node::check_mail(const cown_ptr<Node> & self) {
 struct LeaderDAG: public ActorBenchmark {
     uint64_t servers;
     uint64_t max_nodes_per_layer;
+    // counts the nodes made; owned here so behaviours share a plain pointer
+    std::unique_ptr<Latch> built;
     
     LeaderDAG(uint64_t servers, uint64_t max_nodes_per_layer): servers(servers), max_nodes_per_layer(max_nodes_per_layer) {}
 
@@ -195,15 +177,13 @@ struct LeaderDAG: public ActorBenchmark {
     void init_children(cown_ptr<leader_dag::Node> parent, 
                     cown_ptr<std::vector<K>> children_per_node, 
                     cown_ptr<std::vector<K>> ids, 
-                    cown_ptr<leader_dag::Counter<K>> counter) {
+                    Latch * built) {
         using namespace leader_dag;
         when (children_per_node, parent, ids) << [=](
                     acquired_cown<std::vector<K>> children_per_node_list, 
                     acquired_cown<leader_dag::Node> parent, 
                     acquired_cown<std::vector<K>> id_list) {
-            if (id_list->empty()) {
-                Counter<K>::done(counter);
-            } else {
+            if (!id_list->empty()) {
                 K num_children = children_per_node_list->back();
                 children_per_node_list->pop_back();
                 for (K i = 0; i < num_children; i++) {
@@ -211,8 +191,8 @@ struct LeaderDAG: public ActorBenchmark {
                     cown_ptr<leader_dag::Node> c = make_cown<leader_dag::Node>(id_list->back(), parent.cown());
                     parent->children.push_back(c);
                     id_list->pop_back();
-                    Counter<K>::add(counter);
-                    init_children<K>(c, children_per_node, ids, counter);     
+                    built->arrive();
+                    init_children<K>(c, children_per_node, ids, built);     
                 }
             }
         };
@@ -228,10 +208,10 @@ struct LeaderDAG: public ActorBenchmark {
                 // INV: children_per_node.size == 0 ==> ids.size == 0
                 cown_ptr<leader_dag::Node> root = make_cown<leader_dag::Node>(ids->back());
                 ids->pop_back();
-                cown_ptr<Counter<uint64_t>> counter = make_cown<Counter<uint64_t>>(servers-1, [=]() {
+                built = std::make_unique<Latch>(servers-1, [=]() {
                     Node::start(root, make_cown<uint64_t>(100));
                 });
-                init_children<uint64_t>(root, children_per_node, ids.cown(), counter);
+                init_children<uint64_t>(root, children_per_node, ids.cown(), built.get());
             };
         };
     }
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "breakfast_ideal.h"
+#include "util/random.h"
+#include "util/resource.h"
+#include <atomic>
+#include <cmath>
+
+namespace jake_benchmark {
+
+// breakfast_ideal grown into a restaurant kitchen: orders arrive on their own
+// schedule, every order is a breakfast of its own, and all of them share a pool
+// of pan spaces and a pool of toasters. Each order is finished with a join over
+// its food, so the kitchen is many independent multi-cown pipelines contending
+// for a few shared resources.
+namespace kitchen {
+
+    using namespace breakfast_ideal;
+
+    struct Config {
+        size_t orders = 1000;
+        size_t pans = 4;
+        size_t pan_capacity = 4;
+        size_t toasters = 2;
+        // mean simulated time between two orders
+        double arrival_ms = 2000;
+        uint64_t seed = 0;
+    };
+
+    struct Order {
+        size_t id;
+        int bacon;
+        int eggs;
+        bool toast;
+        bool coffee;
+        timer::Clock::duration arrival;
+    };
+
+    using PanSpaces = resource::Pool<size_t>;
+    using Toasters = resource::Pool<size_t>;
+
+    // What goes on the plate; the arrival is left to the caller.
+    inline Order draw(XorOshiro128Plus & rand, size_t id) {
+        Order order;
+        order.id = id;
+        order.bacon = 1 + (int)rand.integer(3);
+        order.eggs = (int)rand.integer(3);
+        order.toast = rand.integer(2) == 0;
+        order.coffee = rand.integer(2) == 0;
+        return order;
+    }
+
+    // Orders arrive as a Poisson process, so the same seed gives the same orders at
+    // the same times.
+    inline std::vector<Order> generate(const Config & config) {
+        XorOshiro128Plus rand(config.seed);
+        std::vector<Order> orders;
+        orders.reserve(config.orders);
+        double at_ms = 0;
+        for (size_t i = 0; i < config.orders; i++) {
+            at_ms += -std::log(1 - rand.real()) * config.arrival_ms;
+            Order order = draw(rand, i);
+            order.arrival = std::chrono::duration_cast<timer::Clock::duration>(std::chrono::duration<double, std::milli>(at_ms));
+            orders.push_back(order);
+        }
+        return orders;
+    }
+
+    // Every pan contributes pan_capacity spaces, all tagged with the pan they are in.
+    inline cown_ptr<PanSpaces> make_pans(const Config & config) {
+        std::vector<size_t> spaces;
+        for (size_t pan = 0; pan < config.pans; pan++)
+            for (size_t i = 0; i < config.pan_capacity; i++)
+                spaces.push_back(pan);
+        return make_cown<PanSpaces>(spaces);
+    }
+
+    inline cown_ptr<Toasters> make_toasters(const Config & config) {
+        std::vector<size_t> toaster_ids;
+        for (size_t toaster = 0; toaster < config.toasters; toaster++)
+            toaster_ids.push_back(toaster);
+        return make_cown<Toasters>(toaster_ids);
+    }
+
+    // Cooks one order with the shared pans and toasters, and runs `served` once
+    // all of its food is ready.
+    inline void prepare(const Order & order, cown_ptr<PanSpaces> pans, cown_ptr<Toasters> toasters, std::function<void()> served) {
+        std::vector<FoodCown> food;
+
+        std::vector<FryableCown> fryables;
+        for (int i = 1; i <= order.bacon; i++)
+            fryables.push_back(make_cown<Bacon>(i));
+        for (int i = 1; i <= order.eggs; i++)
+            fryables.push_back(make_cown<Egg>(i));
+        for (auto & f : fryables) {
+            PanSpaces::acquire(pans, [=](size_t pan) {
+                Pan::fry(f, [=]() { PanSpaces::release(pans, pan); });
+            });
+            std::visit([&](auto && cown) {
+                food.emplace_back(cown);
+            }, f);
+        }
+
+        if (order.toast) {
+            cown_ptr<Bread> bread = make_cown<Bread>();
+            Toasters::acquire(toasters, [=](size_t toaster) {
+                when (bread) << [=](acquired_cown<Bread> b) {
+                    timer::busy_for(b, std::chrono::seconds(b->toast_time()), [=](acquired_cown<Bread> & b) {
+                        b->toasted = true;
+                        b->changed();
+                        Toasters::release(toasters, toaster);
+                        cown_ptr<Bread> toast = bread;
+                        Bread::add_jam(toast);
+                        Bread::add_butter(toast);
+                    });
+                };
+            });
+            food.push_back(bread);
+        }
+
+        cown_ptr<Cup> cup = make_cown<Cup>();
+        if (order.coffee)
+            Cup::pour_coffee(cup);
+        else
+            Cup::pour_juice(cup);
+        food.push_back(cup);
+
+        join::when_all(food, [](auto & item, join::Arrival arrive) {
+            item->when_ready(arrive);
+        }, served);
+    }
+};
+
+struct Kitchen : public ActorBenchmark {
+    static const inline std::string name = "kitchen";
+
+    using PanSpaces = kitchen::PanSpaces;
+    using Toasters = kitchen::Toasters;
+
+    kitchen::Config config;
+    std::vector<kitchen::Order> orders;
+    std::vector<double> latency_s;
+    std::atomic<size_t> completed{0};
+    timer::Clock::time_point begin;
+    double makespan_s = 0;
+    double wall_ms = 0;
+
+    Kitchen(kitchen::Config config): config(config), orders(kitchen::generate(config)) {}
+
+    void run() {
+        using namespace kitchen;
+        timer::reset();
+        begin = timer::Clock::now();
+        completed = 0;
+        latency_s.assign(orders.size(), 0);
+        when (make_cown<Bool>(true)) << [=](acquired_cown<Bool>) {
+            cown_ptr<PanSpaces> pans = make_pans(config);
+            cown_ptr<Toasters> toasters = make_toasters(config);
+            for (auto const& order : orders)
+                timer::after(order.arrival, [=]() { take(order, pans, toasters); });
+        };
+    }
+
+    void take(const kitchen::Order & order, cown_ptr<PanSpaces> pans, cown_ptr<Toasters> toasters) {
+        timer::Clock::duration arrival = order.arrival;
+        size_t id = order.id;
+        kitchen::prepare(order, pans, toasters, [=]() {
+            latency_s[id] = std::chrono::duration<double>(timer::elapsed() - arrival).count();
+            if (++completed == orders.size()) {
+                makespan_s = std::chrono::duration<double>(timer::elapsed()).count();
+                wall_ms = std::chrono::duration<double, std::milli>(timer::Clock::now() - begin).count();
+            }
+        });
+    }
+
+    // Throughput is per simulated second, and per real second, which under
+    // --virtual-clock is how fast the runtime can push orders through.
+    std::vector<std::pair<std::string, double>> metrics() {
+        double count = (double)orders.size();
+        return {
+            {"orders_per_s", makespan_s > 0 ? count / makespan_s : 0},
+            {"orders_per_wall_s", wall_ms > 0 ? count / (wall_ms / 1000) : 0},
+            {"latency_p50_s", SampleStats::percentile(latency_s, 0.5)},
+            {"latency_p90_s", SampleStats::percentile(latency_s, 0.9)},
+            {"latency_p99_s", SampleStats::percentile(latency_s, 0.99)},
+            {"makespan_s", makespan_s},
+            {"wall_ms", wall_ms}
+        };
+    }
+};
+
+};
@@ -0,0 +1,92 @@
+#include "util/bench.h"
+#include "util/latch.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace jake_benchmark {
+
+// Many behaviours counting down to one continuation, through a single counter cown
+// (the Counter<K> of the experimental elections) or through a Latch. Run with
+// --scale to see how each holds up as workers are added.
+namespace latch_contention {
+
+// One cown every arrival queues on, as in the experimental leader_dag.
+struct CownCounter {
+    static constexpr const char* name = "cown";
+
+    struct Counter {
+        uint64_t remaining;
+        std::function<void()> on_complete;
+
+        Counter(uint64_t initial, std::function<void()> cb): remaining(initial), on_complete(cb) {}
+    };
+
+    cown_ptr<Counter> counter;
+
+    CownCounter(uint64_t count, std::function<void()> then): counter(make_cown<Counter>(count, then)) {}
+
+    void arrive() {
+        when (counter) << [](acquired_cown<Counter> counter) {
+            if (--counter->remaining == 0)
+                counter->on_complete();
+        };
+    }
+};
+
+struct ShardedLatch {
+    static constexpr const char* name = "latch";
+
+    Latch latch;
+
+    ShardedLatch(uint64_t count, std::function<void()> then): latch(count, then) {}
+
+    void arrive() { latch.arrive(); }
+};
+
+};
+
+// `tasks` independent behaviours, each arriving `arrivals` times, and a continuation
+// that fires once they all have.
+template <typename Counting>
+struct LatchContention: public BocBenchmark {
+    static const inline std::string name = std::string("latch_") + Counting::name;
+
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t tasks;
+    uint64_t arrivals;
+    std::unique_ptr<Counting> counting;
+    std::atomic<uint64_t> fired{0};
+    std::atomic<int64_t> elapsed_ns{0};
+
+    LatchContention(uint64_t tasks, uint64_t arrivals): tasks(tasks), arrivals(arrivals) {}
+
+    void run() {
+        fired = 0;
+        Clock::time_point begin = Clock::now();
+        counting = std::make_unique<Counting>(tasks * arrivals, [this, begin]() {
+            elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+            fired++;
+        });
+        Counting* c = counting.get();
+        for (uint64_t t = 0; t < tasks; t++) {
+            when () << [c, n = arrivals]() {
+                for (uint64_t i = 0; i < n; i++)
+                    c->arrive();
+            };
+        }
+    }
+
+    // `fired` is 1 when the continuation ran exactly once.
+    std::vector<std::pair<std::string, double>> metrics() {
+        double us = elapsed_ns / 1e3;
+        return {
+            {"fired", (double)fired},
+            {"countdown_us", us},
+            {"arrivals_per_us", us > 0 ? (double)(tasks * arrivals) / us : 0}
+        };
+    }
+};
+
+};
@@ -1,5 +1,7 @@
 #include "util/bench.h"
 #include "util/random.h"
+#include "util/cowns.h"
+#include "util/topology.h"
 #include "../typecheck.h"
 #include "../safe_print.h"
 #include "../rng.h"
@@ -23,19 +25,11 @@ struct Node {
     uint64_t highest_id;
     uint64_t total_servers;
 
-    Node(uint64_t id, uint64_t counter): id(id), highest_id(id), total_servers(counter) {
-        debug(" Made node with id : " , id);
-    }
-
-    static void add_neighbour(const cown_ptr<Node> & self, cown_ptr<Node> neighbour) {
-        when (self, neighbour) << [=](acquired_cown<Node> self, acquired_cown<Node> neighbour) {
-            self->neighbours.push_back(neighbour.cown());
-            neighbour->neighbours.push_back(self.cown());
-        };
-    }
+    Node(uint64_t id, uint64_t counter): id(id), highest_id(id), total_servers(counter) {}
 
     static void start(const cown_ptr<Node> & self) {
         when (self) << [=](acquired_cown<Node> self) {
+            ALLOC_TAG("leader_arbitrary::start");
             if (self->state != Candidate) {
                 //debug(" start to id : ", self->id);
                 self->state = Candidate;
@@ -49,6 +43,7 @@ struct Node {
 
     static void propagate_ids(const cown_ptr<Node> & self) {
         when(self) << [=](acquired_cown<Node> self) {
+            ALLOC_TAG("leader_arbitrary::propagate_ids");
             if (self->state == Candidate) {
                 for (auto const& child : self->neighbours)
                     receive_id(child, self->received_from, self->highest_id);
@@ -59,6 +54,7 @@ struct Node {
 
     static void receive_id(const cown_ptr<Node> & self, std::unordered_set<uint64_t> seen, uint64_t highest_id) {
         when(self) << [=](acquired_cown<Node> self) {
+            ALLOC_TAG("leader_arbitrary::receive_id");
             if (self->state == Candidate) {
                 self->received_from.insert(seen.begin(), seen.end());
                 //debug(" id : ", self->id, " -- recv prop : ", highest_id ," seen: ", self->received_from.size());
@@ -76,6 +72,7 @@ struct Node {
 
     static void election_result(const cown_ptr<Node> & self, uint64_t sender_id) {
         when(self) << [=](acquired_cown<Node> self) {
+            ALLOC_TAG("leader_arbitrary::election_result");
             if (self->state == Candidate) {
                 self->highest_id = sender_id;
                 declare_leader(self.cown());
@@ -85,6 +82,7 @@ struct Node {
 
     static void declare_leader(const cown_ptr<Node> & self) {
         when(self) << [=](acquired_cown<Node> self) {
+            ALLOC_TAG("leader_arbitrary::declare_leader");
             if (self->state == Candidate) {
                 self->state = (self->id == self->highest_id) ? Leader : Follower;
                 for (auto const& child : self->neighbours)
@@ -97,59 +95,38 @@ struct Node {
 };
 
 struct LeaderArbitrary: public ActorBenchmark {
-    uint64_t servers;
-    uint64_t edges;
+    topology::Graph graph;
+    // setup behaviours to build and wire the nodes in; 0 does it all in one
+    uint64_t shards;
+    double setup_ms = 0;
     
-    LeaderArbitrary(uint64_t servers, uint64_t edges): servers(servers), edges(edges) {} 
-
-    template <typename K>
-    void init_nodes(cown_ptr<leader_arbitrary::Node> root, 
-                    cown_ptr<std::vector<K>> ids,
-                    std::function<void()> callback) {
-        using namespace leader_arbitrary;
-        when (root, ids) << [=](
-                    acquired_cown<Node> root, 
-                    acquired_cown<std::vector<K>> id_list) {
-            std::vector<cown_ptr<Node>> nodes;
-            while (!id_list->empty()) {
-                nodes.push_back(make_cown<Node>(id_list->back(), servers));
-                id_list->pop_back();
-            }
-            nodes.push_back(root.cown());
-            for (K i = 1; i < nodes.size(); i++)
-                Node::add_neighbour(nodes[i-1], nodes[i]);
-
-            std::mt19937 rng;
-            std::uniform_int_distribution<K> dist(0, nodes.size()-1);
-
-            K remaining = edges;
-            while (remaining > 0) {
-                K from = dist(rng);
-                K to = dist(rng);
-                if (from != to) {
-                    Node::add_neighbour(nodes[from], nodes[to]);
-                    remaining--;
-                }
-            }
-            callback();
-        };
-    }
+    LeaderArbitrary(topology::Spec shape, uint64_t shards = 0): graph(topology::generate(shape)), shards(shards) {} 
 
     void run() {
         using namespace leader_arbitrary;
-        cown_ptr<std::vector<uint64_t>> ids = make_cown<std::vector<uint64_t>>(gen_x_unique_randoms<uint64_t>(servers));
-        when (make_cown<LeaderArbitrary>(servers, edges)) << [=](acquired_cown<LeaderArbitrary> ld) {
-            // PRE: sum(children_per_node) == ids.size
-            when (ids) << [=](acquired_cown<std::vector<uint64_t>> ids) mutable {
-                // INV: children_per_node.size == 0 ==> ids.size == 0
-                cown_ptr<Node> root = make_cown<Node>(ids->back(), servers);
-                ids->pop_back();
-                init_nodes<uint64_t>(root, ids.cown(), [=]() {
-                    Node::start(root);
+        uint64_t servers = graph.nodes();
+        auto ids = std::make_shared<std::vector<uint64_t>>(gen_x_unique_randoms<uint64_t>(servers, std::max(servers*2, 65535ul)));
+        high_resolution_clock::time_point begin = high_resolution_clock::now();
+        if (shards > 0) {
+            make_graph_sharded<Node>(graph, shards,
+                [ids, servers](uint64_t i) { return std::make_tuple((*ids)[i], servers); },
+                [=](std::vector<cown_ptr<Node>> & nodes) {
+                    setup_ms = (double)(duration_cast<microseconds>(high_resolution_clock::now() - begin).count()) / 1000;
+                    Node::start(nodes[0]);
                 });
-            };
+            return;
+        }
+        when (make_cown<uint64_t>(servers)) << [=](acquired_cown<uint64_t>) {
+            std::vector<cown_ptr<Node>> nodes = make_cowns<Node>(servers, [&](uint64_t i) { return std::make_tuple((*ids)[i], servers); });
+            wire_graph(graph, nodes);
+            setup_ms = (double)(duration_cast<microseconds>(high_resolution_clock::now() - begin).count()) / 1000;
+            Node::start(nodes[0]);
         };
     }
+
+    std::vector<std::pair<std::string, double>> metrics() {
+        return {{"setup_ms", setup_ms}};
+    }
 };
 
 };
\ No newline at end of file
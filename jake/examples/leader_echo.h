@@ -0,0 +1,275 @@
+#include "util/bench.h"
+#include "util/random.h"
+#include "util/counter.h"
+#include "util/cowns.h"
+#include "util/topology.h"
+#include "../typecheck.h"
+#include "../safe_print.h"
+#include "../rng.h"
+
+namespace jake_benchmark {
+
+// Echo algorithm with extinction (Tel) on the same graphs as leader_arbitrary.
+// Every node starts its own wave when it is woken by a smaller id, waves meeting a larger
+// wave die out, and only the wave of the highest id is echoed all the way back to its
+// initiator. Each surviving wave crosses every edge twice, so the message count grows
+// with the number of edges rather than with nodes * edges as flooding does.
+namespace leader_echo {
+
+typedef enum {
+    Leader,
+    Follower,
+    Candidate
+} State;
+
+inline ShardedCounter messages;
+
+struct Node {
+    uint64_t id;
+    std::vector<cown_ptr<Node>> neighbours;
+    State state = Follower;
+    bool awake = false;
+    bool decided = false;
+    bool has_wave = false;
+    uint64_t wave = 0;
+    cown_ptr<Node> parent;
+    uint64_t received = 0;
+
+    Node(uint64_t id): id(id) {}
+
+    static void start(const cown_ptr<Node> & self) {
+        when (self) << [=](acquired_cown<Node> self) {
+            if (!self->awake)
+                initiate(self);
+        };
+    }
+
+    // Must be called from inside a behaviour on self.
+    static void initiate(acquired_cown<Node> & self) {
+        self->awake = true;
+        self->state = Candidate;
+        self->has_wave = true;
+        self->wave = self->id;
+        self->parent = nullptr;
+        self->received = 0;
+        if (self->neighbours.empty()) {
+            self->state = Leader;
+            self->decided = true;
+            return;
+        }
+        for (auto const& neighbour : self->neighbours)
+            receive_wave(neighbour, self.cown(), self->id);
+    }
+
+    static void receive_wave(const cown_ptr<Node> & self, cown_ptr<Node> sender, uint64_t wave) {
+        messages.add();
+        when (self) << [=](acquired_cown<Node> self) {
+            if (self->decided)
+                return;
+            if (!self->awake) {
+                if (wave < self->id)
+                    initiate(self);
+                else {
+                    self->awake = true;
+                    self->state = Candidate;
+                }
+            }
+            if (self->has_wave && wave < self->wave)
+                return;
+            if (!self->has_wave || wave > self->wave) {
+                self->has_wave = true;
+                self->wave = wave;
+                self->parent = sender;
+                self->received = 0;
+                bool skipped_parent = false;
+                for (auto const& neighbour : self->neighbours) {
+                    if (!skipped_parent && neighbour == sender) {
+                        skipped_parent = true;
+                        continue;
+                    }
+                    receive_wave(neighbour, self.cown(), wave);
+                }
+            }
+            self->received++;
+            if (self->received == self->neighbours.size()) {
+                if (self->wave == self->id) {
+                    debug(" Leader elected with id : ", self->id);
+                    self->state = Leader;
+                    self->decided = true;
+                    for (auto const& neighbour : self->neighbours)
+                        election_result(neighbour, self->id);
+                }
+                else
+                    receive_wave(self->parent, self.cown(), self->wave);
+            }
+        };
+    }
+
+    static void election_result(const cown_ptr<Node> & self, uint64_t leader_id) {
+        messages.add();
+        when (self) << [=](acquired_cown<Node> self) {
+            if (!self->decided) {
+                self->decided = true;
+                self->state = Follower;
+                self->wave = leader_id;
+                for (auto const& neighbour : self->neighbours)
+                    election_result(neighbour, leader_id);
+            }
+        };
+    }
+};
+
+};
+
+namespace leader_echo_boc {
+
+typedef enum {
+    Leader,
+    Follower,
+    Candidate
+} State;
+
+inline ShardedCounter messages;
+
+// The BoC variant acquires both ends of an edge for every hop. Seeing the sender lets
+// the receiver drop a wave whose sender has already moved on to a larger one, since
+// that wave can never be echoed back to its initiator.
+struct Node {
+    uint64_t id;
+    std::vector<cown_ptr<Node>> neighbours;
+    State state = Follower;
+    bool awake = false;
+    bool decided = false;
+    bool has_wave = false;
+    uint64_t wave = 0;
+    cown_ptr<Node> parent;
+    uint64_t received = 0;
+
+    Node(uint64_t id): id(id) {}
+
+    static void start(const cown_ptr<Node> & self) {
+        when (self) << [=](acquired_cown<Node> self) {
+            if (!self->awake)
+                initiate(self);
+        };
+    }
+
+    // Must be called from inside a behaviour on self.
+    static void initiate(acquired_cown<Node> & self) {
+        self->awake = true;
+        self->state = Candidate;
+        self->has_wave = true;
+        self->wave = self->id;
+        self->parent = nullptr;
+        self->received = 0;
+        if (self->neighbours.empty()) {
+            self->state = Leader;
+            self->decided = true;
+            return;
+        }
+        for (auto const& neighbour : self->neighbours)
+            share_wave(self.cown(), neighbour, self->id);
+    }
+
+    static void share_wave(const cown_ptr<Node> & sender, const cown_ptr<Node> & self, uint64_t wave) {
+        messages.add();
+        when (sender, self) << [=](acquired_cown<Node> sender, acquired_cown<Node> self) {
+            if (self->decided || sender->wave > wave)
+                return;
+            if (!self->awake) {
+                if (wave < self->id)
+                    initiate(self);
+                else {
+                    self->awake = true;
+                    self->state = Candidate;
+                }
+            }
+            if (self->has_wave && wave < self->wave)
+                return;
+            if (!self->has_wave || wave > self->wave) {
+                self->has_wave = true;
+                self->wave = wave;
+                self->parent = sender.cown();
+                self->received = 0;
+                bool skipped_parent = false;
+                for (auto const& neighbour : self->neighbours) {
+                    if (!skipped_parent && neighbour == sender.cown()) {
+                        skipped_parent = true;
+                        continue;
+                    }
+                    share_wave(self.cown(), neighbour, wave);
+                }
+            }
+            self->received++;
+            if (self->received == self->neighbours.size()) {
+                if (self->wave == self->id) {
+                    debug(" Leader elected with id : ", self->id);
+                    self->state = Leader;
+                    self->decided = true;
+                    for (auto const& neighbour : self->neighbours)
+                        election_result(neighbour, self->id);
+                }
+                else
+                    share_wave(self.cown(), self->parent, self->wave);
+            }
+        };
+    }
+
+    static void election_result(const cown_ptr<Node> & self, uint64_t leader_id) {
+        messages.add();
+        when (self) << [=](acquired_cown<Node> self) {
+            if (!self->decided) {
+                self->decided = true;
+                self->state = Follower;
+                self->wave = leader_id;
+                for (auto const& neighbour : self->neighbours)
+                    election_result(neighbour, leader_id);
+            }
+        };
+    }
+};
+
+};
+
+template <typename Node>
+static void make_echo_graph(const topology::Graph & graph) {
+    uint64_t servers = graph.nodes();
+    std::vector<uint64_t> ids = gen_x_unique_randoms<uint64_t>(servers, std::max(servers*2, 65535ul));
+    when (make_cown<uint64_t>(servers)) << [=, &graph](acquired_cown<uint64_t>) {
+        std::vector<cown_ptr<Node>> nodes = make_cowns<Node>(servers, [&](uint64_t i) { return std::make_tuple(ids[i]); });
+        wire_graph(graph, nodes);
+        Node::start(nodes[0]);
+    };
+}
+
+struct LeaderEcho: public ActorBenchmark {
+    topology::Graph graph;
+
+    LeaderEcho(topology::Spec shape): graph(topology::generate(shape)) {}
+
+    void run() {
+        leader_echo::messages.reset();
+        make_echo_graph<leader_echo::Node>(graph);
+    }
+
+    std::vector<std::pair<std::string, double>> metrics() {
+        return {{"messages", (double)leader_echo::messages.total()}};
+    }
+};
+
+struct LeaderEchoBoC: public BocBenchmark {
+    topology::Graph graph;
+
+    LeaderEchoBoC(topology::Spec shape): graph(topology::generate(shape)) {}
+
+    void run() {
+        leader_echo_boc::messages.reset();
+        make_echo_graph<leader_echo_boc::Node>(graph);
+    }
+
+    std::vector<std::pair<std::string, double>> metrics() {
+        return {{"messages", (double)leader_echo_boc::messages.total()}};
+    }
+};
+
+};
@@ -0,0 +1,207 @@
+#include "util/bench.h"
+#include "util/random.h"
+#include "util/cowns.h"
+#include "util/topology.h"
+#include "../election.h"
+#include "../rng.h"
+#include "../safe_print.h"
+
+namespace jake_benchmark {
+
+// Algorithms for election::ElectionNode. Each one is a policy class whose hooks are
+// templates over the Context, so they inline into whichever paradigm delivers them.
+namespace leader_generic {
+
+using election::Leader;
+using election::Follower;
+using election::Candidate;
+
+// Chang and Roberts on a unidirectional ring: a probe carrying an id is only
+// forwarded by nodes with a smaller id, so only the highest id gets all the way round.
+struct ChangRoberts {
+    static constexpr const char* name = "chang_roberts";
+
+    typedef enum {
+        Probe,
+        Elected
+    } Kind;
+
+    struct Message {
+        Kind kind;
+        uint64_t id;
+    };
+
+    template <typename Node>
+    struct State {
+        uint64_t highest;
+        bool participating = false;
+
+        State(uint64_t id): highest(id) {}
+    };
+
+    template <typename Ctx>
+    static void on_start(Ctx & ctx) {
+        if (!ctx.state().participating) {
+            ctx.state().participating = true;
+            ctx.set_state(Candidate);
+            ctx.send(0, Message{Probe, ctx.id()});
+        }
+    }
+
+    template <typename Ctx>
+    static void on_message(Ctx & ctx, const Message & msg) {
+        auto & state = ctx.state();
+        switch (msg.kind) {
+            case Probe:
+                if (msg.id == ctx.id()) {
+                    debug("Node ", ctx.id(), " became leader");
+                    ctx.set_state(Leader);
+                    ctx.send(0, Message{Elected, msg.id});
+                }
+                else if (msg.id > state.highest) {
+                    state.highest = msg.id;
+                    state.participating = true;
+                    ctx.set_state(Candidate);
+                    ctx.send(0, msg);
+                }
+                else
+                    on_start(ctx);
+                break;
+            case Elected:
+                if (msg.id != ctx.id()) {
+                    state.highest = msg.id;
+                    ctx.set_state(Follower);
+                    ctx.send(0, msg);
+                }
+                break;
+        }
+    }
+};
+
+// Echo with extinction on any connected graph, as in leader_echo. Under BoC a wave
+// whose sender has already adopted a larger one is dropped on arrival.
+struct EchoExtinction {
+    static constexpr const char* name = "echo";
+
+    typedef enum {
+        Wave,
+        Elected
+    } Kind;
+
+    struct Message {
+        Kind kind;
+        uint64_t id;
+    };
+
+    template <typename Node>
+    struct State {
+        bool awake = false;
+        bool decided = false;
+        bool has_wave = false;
+        uint64_t wave = 0;
+        uint64_t received = 0;
+        cown_ptr<Node> parent;
+
+        State(uint64_t) {}
+    };
+
+    template <typename Ctx>
+    static void initiate(Ctx & ctx) {
+        auto & state = ctx.state();
+        state.awake = true;
+        state.has_wave = true;
+        state.wave = ctx.id();
+        state.parent = nullptr;
+        state.received = 0;
+        ctx.set_state(Candidate);
+        if (ctx.degree() == 0) {
+            state.decided = true;
+            ctx.set_state(Leader);
+            return;
+        }
+        ctx.broadcast(Message{Wave, ctx.id()});
+    }
+
+    template <typename Ctx>
+    static void on_start(Ctx & ctx) {
+        if (!ctx.state().awake)
+            initiate(ctx);
+    }
+
+    template <typename Ctx>
+    static void on_message(Ctx & ctx, const Message & msg) {
+        auto & state = ctx.state();
+        if (state.decided)
+            return;
+        if (msg.kind == Elected) {
+            state.decided = true;
+            state.wave = msg.id;
+            ctx.set_state(Follower);
+            ctx.broadcast(msg);
+            return;
+        }
+        if (ctx.sender != nullptr && ctx.sender->algorithm.wave > msg.id)
+            return;
+        if (!state.awake) {
+            if (msg.id < ctx.id())
+                initiate(ctx);
+            else {
+                state.awake = true;
+                ctx.set_state(Candidate);
+            }
+        }
+        if (state.has_wave && msg.id < state.wave)
+            return;
+        if (!state.has_wave || msg.id > state.wave) {
+            state.has_wave = true;
+            state.wave = msg.id;
+            state.parent = ctx.from;
+            state.received = 0;
+            ctx.broadcast_except(ctx.from, msg);
+        }
+        state.received++;
+        if (state.received == ctx.degree()) {
+            if (state.wave == ctx.id()) {
+                debug(" Leader elected with id : ", ctx.id());
+                state.decided = true;
+                ctx.set_state(Leader);
+                ctx.broadcast(Message{Elected, ctx.id()});
+            }
+            else
+                ctx.send_to(state.parent, Message{Wave, state.wave});
+        }
+    }
+};
+
+};
+
+template <typename Topology, typename Algorithm, typename Paradigm>
+struct LeaderGeneric: public AsyncBenchmarkBase {
+    using Node = election::ElectionNode<Topology, Algorithm, Paradigm>;
+
+    static const inline std::string name = std::string("leader_generic_") + Algorithm::name + "_" + Paradigm::name;
+
+    topology::Graph graph;
+
+    LeaderGeneric(topology::Spec shape): graph(Topology::graph(shape)) {}
+
+    std::string paradigm() { return Paradigm::name; }
+
+    void run() {
+        Node::messages.reset();
+        uint64_t servers = graph.nodes();
+        std::vector<uint64_t> ids = gen_x_unique_randoms<uint64_t>(servers, std::max(servers*2, 65535ul));
+        when (make_cown<uint64_t>(servers)) << [=](acquired_cown<uint64_t>) {
+            std::vector<cown_ptr<Node>> nodes = make_cowns<Node>(servers, [&](uint64_t i) { return std::make_tuple(ids[i]); });
+            for (uint64_t i = 0; i < servers; i++)
+                Node::set_links(nodes[i], Topology::links(graph, i, nodes));
+            Node::start(nodes[0]);
+        };
+    }
+
+    std::vector<std::pair<std::string, double>> metrics() {
+        return {{"messages", (double)Node::messages.total()}};
+    }
+};
+
+};
@@ -1,5 +1,6 @@
 #include "util/bench.h"
 #include "util/random.h"
+#include "util/cowns.h"
 #include "../typecheck.h"
 #include "../rng.h"
 #include "../safe_print.h"
@@ -19,9 +20,9 @@ struct Node {
     cown_ptr<Node> next;
     State state = Follower;
 
-    Node(uint64_t id): id(id) {
-        debug(" Made Node with id : ", id);
-    }
+    Node(uint64_t id): id(id) {}
+
+    Node(uint64_t id, cown_ptr<Node> next): id(id), next(next) {}
 
     static void propagate_id(const cown_ptr<Node> & self, uint64_t message_id) {
         when (self) << [=, tag=self](acquired_cown<Node> self) {
@@ -43,8 +44,9 @@ struct Node {
                 declare_leader(self->next, id);
             }
             else {
+                // every starter's message ends at the leader, so the ring goes quiet
+                // once the last announcement gets back here
                 debug("Node ", self->id, " became leader");
-                std::exit(0);
             }
         };
     }
@@ -52,34 +54,46 @@ struct Node {
 
 };
 struct LeaderRing: public ActorBenchmark {
+    static const inline std::string name = "leader_ring";
+
     uint64_t servers;
     uint64_t starters;
+    // setup behaviours to build the ring in; 0 builds it in one
+    uint64_t shards;
+    double setup_ms = 0;
     
-    LeaderRing(uint64_t servers, uint64_t starters): servers(servers), starters(starters) {} 
+    LeaderRing(uint64_t servers, uint64_t starters, uint64_t shards = 0): servers(servers), starters(starters), shards(shards) {} 
+
+    void start(const std::vector<cown_ptr<leader_ring::Node>> & server_list, high_resolution_clock::time_point begin) {
+        using namespace leader_ring;
+        setup_ms = (double)(duration_cast<microseconds>(high_resolution_clock::now() - begin).count()) / 1000;
+
+        std::vector<uint64_t> starts = gen_x_unique_randoms<uint64_t>(starters, servers-1);
+        for (uint64_t i = 0; i < starters; i++) {
+            Node::propagate_id(server_list[starts[i]], 0);
+        }
+    }
 
     void run() {
         using namespace leader_ring;
-        std::vector<uint64_t> ids = gen_x_unique_randoms<uint64_t>(servers, 65535);
+        auto ids = std::make_shared<std::vector<uint64_t>>(gen_x_unique_randoms<uint64_t>(servers, std::max(servers*2, 65535ul)));
+        high_resolution_clock::time_point begin = high_resolution_clock::now();
+        if (shards > 0) {
+            make_ring_sharded<Node>(servers, shards,
+                [ids](uint64_t i, cown_ptr<Node> next) { return std::make_tuple((*ids)[i], next); },
+                [=](std::vector<cown_ptr<Node>> & server_list) { start(server_list, begin); });
+            return;
+        }
         when (make_cown<LeaderRing>(servers, starters)) << [=](acquired_cown<LeaderRing> ld) {
-            std::vector<cown_ptr<leader_ring::Node>> server_list;
-            for (uint64_t i = 0; i < servers; i++) {
-                server_list.emplace_back(make_cown<Node>(ids[i]));
-            }
-            for (uint64_t i = 0; i < servers - 1; i++) {
-                when (server_list[i]) << [next=server_list[i + 1]](acquired_cown<Node> svr) {
-                    svr->next = next;
-                };
-            }
-
-            when (server_list[servers - 1]) << [first=server_list[0]](acquired_cown<Node> svr) {
-                svr->next = first;
-            };
-            std::vector<uint64_t> starts = gen_x_unique_randoms<uint64_t>(starters, servers-1);
-            for (uint64_t i = 0; i < starters; i++) {
-                Node::propagate_id(server_list[starts[i]], 0);
-            }
+            std::vector<cown_ptr<leader_ring::Node>> server_list = make_ring<Node>(servers,
+                [&](uint64_t i, cown_ptr<Node> next) { return std::make_tuple((*ids)[i], next); });
+            start(server_list, begin);
         };
     }
+
+    std::vector<std::pair<std::string, double>> metrics() {
+        return {{"setup_ms", setup_ms}};
+    }
 };
 
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "util/bench.h"
 #include "util/random.h"
+#include "util/cowns.h"
 #include "../typecheck.h"
 #include "../rng.h"
 
@@ -19,9 +20,9 @@ struct Node {
     cown_ptr<Node> next;
     State state = Follower;
 
-    Node(uint64_t id): id(id), highest_id(id) {
-        std::cout << " Made server with id : " << id << std::endl;
-    }
+    Node(uint64_t id): id(id), highest_id(id) {}
+
+    Node(uint64_t id, cown_ptr<Node> next): id(id), highest_id(id), next(next) {}
 
     static void share_ids(const cown_ptr<Node> & self, const cown_ptr<Node> & next) {
         when (self, next) << [=](acquired_cown<Node> self, acquired_cown<Node> next) {
@@ -60,31 +61,14 @@ struct LeaderRingBoC: public BocBenchmark {
     LeaderRingBoC(uint64_t servers, uint64_t starters): servers(servers), starters(starters) {} 
     void run() {
         using namespace leader_ring_boc;
-        std::vector<uint64_t> ids = gen_x_unique_randoms<uint64_t>(servers);
+        std::vector<uint64_t> ids = gen_x_unique_randoms<uint64_t>(servers, std::max(servers*2, 65535ul));
         when (make_cown<LeaderRingBoC>(servers, starters)) << [=](acquired_cown<LeaderRingBoC> ld) {
-            std::vector<cown_ptr<leader_ring_boc::Node>> server_list;
-            cown_ptr<uint64_t> completed = make_cown<uint64_t>(0);
-            for (uint64_t i = 0; i < servers; i++) {
-                server_list.emplace_back(make_cown<Node>(ids[i]));
-            }
-            for (uint64_t i = 0; i < servers - 1; i++) {
-                when (server_list[i], completed) << [next=server_list[i + 1]](auto svr, auto completed) {
-                    svr->next = next;
-                    completed++;
-                };
-            }
-            when (server_list[servers - 1], completed) << [first=server_list[0]](auto svr, auto completed) {
-                svr->next = first;
-                completed++;
-            };
-            when (completed) << [=](auto completed) {
-                if (completed == servers) {
-                    std::vector<uint64_t> starts = gen_x_unique_randoms<uint64_t>(1, servers-2);
-                    //for (uint64_t i = 0; i < starters; i++)
-                    //    Node::share_ids(server_list[starts[i]], server_list[starts[i]+1]);
-                    Node::share_ids(server_list[starts[0]], server_list[starts[0]+1]);
-                }
-            };
+            std::vector<cown_ptr<leader_ring_boc::Node>> server_list = make_ring<Node>(servers,
+                [&](uint64_t i, cown_ptr<Node> next) { return std::make_tuple(ids[i], next); });
+            std::vector<uint64_t> starts = gen_x_unique_randoms<uint64_t>(1, servers-2);
+            //for (uint64_t i = 0; i < starters; i++)
+            //    Node::share_ids(server_list[starts[i]], server_list[starts[i]+1]);
+            Node::share_ids(server_list[starts[0]], server_list[starts[0]+1]);
         };
     }
 };
@@ -0,0 +1,130 @@
+#include "util/bench.h"
+#include "util/counter.h"
+#include "util/cowns.h"
+#include "util/perf.h"
+#include "../layout.h"
+#include "../rng.h"
+#include "../safe_print.h"
+#include <array>
+#include <unordered_set>
+
+namespace jake_benchmark {
+
+// leader_ring with the node split into hot and cold fields and laid out by a
+// layout::Storage policy, to see what packing, padding and splitting cown payloads
+// does to a workload of small, frequent messages between neighbouring cowns.
+namespace leader_ring_layout {
+
+typedef enum {
+    Leader,
+    Follower,
+    Candidate
+} State;
+
+// Read or written by every message.
+template <typename Node>
+struct Hot {
+    uint64_t id;
+    cown_ptr<Node> next;
+    State state = Follower;
+};
+
+// Only touched once per node, when the leader is announced: the kind of
+// bookkeeping (as in leader_arbitrary's received_from) that real nodes carry.
+struct Cold {
+    std::unordered_set<uint64_t> seen;
+    uint64_t announcements = 0;
+    std::array<uint64_t, 8> history{};
+};
+
+inline ShardedCounter messages;
+
+template <typename Layout>
+struct Node: public Layout::template Storage<Hot<Node<Layout>>, Cold> {
+    using Storage = typename Layout::template Storage<Hot<Node<Layout>>, Cold>;
+
+    Node(uint64_t id, cown_ptr<Node> next): Storage(id, next) {}
+
+    // for make_ring, as the link lives in the hot part
+    cown_ptr<Node> & link() { return this->hot().next; }
+
+    static void propagate_id(const cown_ptr<Node> & self, uint64_t message_id) {
+        messages.add();
+        when (self) << [=](acquired_cown<Node> self) {
+            Hot<Node> & hot = self->hot();
+            hot.state = Candidate;
+            if (message_id == hot.id) {
+                hot.state = Leader;
+                declare_leader(self.cown(), message_id);
+            }
+            else {
+                propagate_id(hot.next, std::max(message_id, hot.id));
+            }
+        };
+    }
+
+    static void declare_leader(const cown_ptr<Node> & self, uint64_t id) {
+        messages.add();
+        when (self) << [=](acquired_cown<Node> self) {
+            Cold & cold = self->cold();
+            cold.history[cold.announcements++ % cold.history.size()] = id;
+            cold.seen.insert(id);
+            if (self->hot().state != Leader) {
+                self->hot().state = Follower;
+                declare_leader(self->hot().next, id);
+            }
+            else {
+                debug("Node ", self->hot().id, " became leader");
+            }
+        };
+    }
+};
+
+};
+
+template <typename Layout>
+struct LeaderRingLayout: public ActorBenchmark {
+    using Node = leader_ring_layout::Node<Layout>;
+
+    static const inline std::string name = std::string("leader_ring_") + Layout::name;
+
+    uint64_t servers;
+    uint64_t starters;
+    perf::Counters counters;
+
+    LeaderRingLayout(uint64_t servers, uint64_t starters): servers(servers), starters(std::min(starters, servers - 1)) {}
+
+    void run() {
+        using namespace leader_ring_layout;
+        messages.reset();
+        std::vector<uint64_t> ids = gen_x_unique_randoms<uint64_t>(servers, std::max(servers*2, 65535ul));
+        std::vector<uint64_t> starts = gen_x_unique_randoms<uint64_t>(starters, servers-1);
+        when (make_cown<uint64_t>(servers)) << [=](acquired_cown<uint64_t>) {
+            std::vector<cown_ptr<Node>> ring = make_ring<Node>(servers, [&](size_t i, cown_ptr<Node> next) {
+                return std::make_tuple(ids[i], next);
+            });
+            // Counting starts with the election, so building the ring is left out.
+            // The counters were opened with the benchmark, before the workers were
+            // started, so the workers have copies to enable.
+            counters.start();
+            for (uint64_t start : starts)
+                Node::propagate_id(ring[start], 0);
+        };
+    }
+
+    // Counters cover the election, from the first message to the runtime going
+    // quiescent, and are per message, so the layouts can be compared directly.
+    std::vector<std::pair<std::string, double>> metrics() {
+        counters.stop();
+        uint64_t sent = leader_ring_layout::messages.total();
+        std::vector<std::pair<std::string, double>> result = {
+            {"payload_bytes", (double)sizeof(Node)},
+            {"messages", (double)sent}
+        };
+        for (auto & metric : counters.metrics("", sent > 0 ? (double)sent : 1))
+            result.emplace_back(metric.first + "_per_message", metric.second);
+        return result;
+    }
+};
+
+};
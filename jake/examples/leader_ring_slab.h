@@ -0,0 +1,97 @@
+#include "util/bench.h"
+#include "util/random.h"
+#include "util/cowns.h"
+#include "../rng.h"
+#include "../safe_print.h"
+
+namespace jake_benchmark {
+
+// leader_ring with the nodes kept in a Slab (util/cowns.h): the payloads sit back to
+// back in one array behind thin cowns, and point to their successor by index, so it
+// can be compared with leader_ring, where every node is a cown of its own.
+namespace leader_ring_slab {
+
+typedef enum {
+    Leader,
+    Follower,
+    Candidate
+} State;
+
+struct Node {
+    uint64_t id;
+    uint64_t next;
+    State state = Follower;
+
+    Node(uint64_t id, uint64_t next): id(id), next(next) {}
+};
+
+using Ring = Slab<Node>;
+using Guard = Ring::Guard;
+
+inline void declare_leader(const Ring * ring, uint64_t index, uint64_t id);
+
+inline void propagate_id(const Ring * ring, uint64_t index, uint64_t message_id) {
+    when (ring->cowns[index]) << [=](acquired_cown<Guard> guard) {
+        Node & self = **guard;
+        self.state = Candidate;
+        if (message_id == self.id) {
+            self.state = Leader;
+            declare_leader(ring, index, message_id);
+        }
+        else {
+            propagate_id(ring, self.next, std::max(message_id, self.id));
+        }
+    };
+}
+
+inline void declare_leader(const Ring * ring, uint64_t index, uint64_t id) {
+    when (ring->cowns[index]) << [=](acquired_cown<Guard> guard) {
+        Node & self = **guard;
+        if (self.state != Leader) {
+            self.state = Follower;
+            declare_leader(ring, self.next, id);
+        }
+        else {
+            debug("Node ", self.id, " became leader");
+        }
+    };
+}
+
+};
+
+struct LeaderRingSlab: public ActorBenchmark {
+    static const inline std::string name = "leader_ring_slab";
+
+    uint64_t servers;
+    uint64_t starters;
+    std::unique_ptr<leader_ring_slab::Ring> ring;
+    double setup_ms = 0;
+
+    LeaderRingSlab(uint64_t servers, uint64_t starters): servers(servers), starters(starters) {}
+
+    void run() {
+        using namespace leader_ring_slab;
+        // the last run's cowns have no behaviours left, so they can go now
+        ring.reset();
+        auto ids = std::make_shared<std::vector<uint64_t>>(gen_x_unique_randoms<uint64_t>(servers, std::max(servers*2, 65535ul)));
+        high_resolution_clock::time_point begin = high_resolution_clock::now();
+        // built in one behaviour, as leader_ring builds its ring
+        when (make_cown<uint64_t>(servers)) << [=](acquired_cown<uint64_t>) {
+            ring = std::make_unique<Ring>(servers, [&](uint64_t i) { return std::make_tuple((*ids)[i], (i + 1) % servers); });
+            setup_ms = (double)(duration_cast<microseconds>(high_resolution_clock::now() - begin).count()) / 1000;
+
+            std::vector<uint64_t> starts = gen_x_unique_randoms<uint64_t>(starters, servers-1);
+            for (uint64_t start : starts)
+                propagate_id(ring.get(), start, 0);
+        };
+    }
+
+    std::vector<std::pair<std::string, double>> metrics() {
+        return {
+            {"setup_ms", setup_ms},
+            {"payload_bytes", (double)sizeof(leader_ring_slab::Node)}
+        };
+    }
+};
+
+};
@@ -0,0 +1,149 @@
+#include "util/bench.h"
+#include "util/random.h"
+#include "util/counter.h"
+#include "../typecheck.h"
+#include "../rng.h"
+#include "../safe_print.h"
+#include <array>
+
+namespace jake_benchmark {
+
+// A generalisation of leader_ring_boc: instead of acquiring two adjacent nodes and
+// advancing one hop, every behaviour acquires K consecutive nodes, carries the highest
+// id through all of them and then moves on to the window starting at its last node.
+// Sweeping K trades the number of behaviours against the cost of acquiring more cowns
+// at once.
+namespace leader_ring_window {
+
+typedef enum {
+    Leader,
+    Follower,
+    Candidate
+} State;
+
+inline ShardedCounter behaviours;
+
+template <size_t K>
+struct Node {
+    static_assert(K >= 2, "a window must contain at least two nodes");
+
+    using Window = std::array<cown_ptr<Node<K>>, K>;
+
+    uint64_t id;
+    uint64_t highest_id;
+    // the K - 1 nodes that follow this one around the ring
+    std::array<cown_ptr<Node<K>>, K - 1> ahead;
+    State state = Follower;
+
+    Node(uint64_t id, std::array<cown_ptr<Node<K>>, K - 1> ahead): id(id), highest_id(id), ahead(ahead) {}
+
+    static void share_ids(const Window & window) {
+        share_ids(window, std::make_index_sequence<K>());
+    }
+
+    template <size_t... I>
+    static void share_ids(const Window & window, std::index_sequence<I...>) {
+        behaviours.add();
+        when (window[I]...) << [=](auto... acquired) {
+            std::array<Node<K>*, K> nodes = { &*acquired... };
+            uint64_t highest_id = nodes[0]->highest_id;
+            nodes[0]->state = Candidate;
+            for (size_t j = 1; j < K; j++) {
+                if (highest_id == nodes[j]->id) {
+                    nodes[j]->state = Leader;
+                    declare_leader(window_at(window, j, *nodes[K - 1]));
+                    return;
+                }
+                highest_id = std::max(highest_id, nodes[j]->highest_id);
+                nodes[j]->highest_id = highest_id;
+                nodes[j]->state = Candidate;
+            }
+            share_ids(next_window(window, *nodes[K - 1]));
+        };
+    }
+
+    static void declare_leader(const Window & window) {
+        declare_leader(window, std::make_index_sequence<K>());
+    }
+
+    template <size_t... I>
+    static void declare_leader(const Window & window, std::index_sequence<I...>) {
+        behaviours.add();
+        when (window[I]...) << [=](auto... acquired) {
+            std::array<Node<K>*, K> nodes = { &*acquired... };
+            for (size_t j = 1; j < K; j++) {
+                if (nodes[j]->state == Leader) {
+                    debug("Node ", nodes[j]->id, " became leader");
+                    return;
+                }
+                nodes[j]->state = Follower;
+            }
+            declare_leader(next_window(window, *nodes[K - 1]));
+        };
+    }
+
+  private:
+    // The window starting at the j-th node of `window`. The nodes up to the end of
+    // `window` are already known, the rest are read from the last node's `ahead`.
+    static Window window_at(const Window & window, size_t j, Node<K> & last) {
+        Window next;
+        for (size_t i = 0; i < K; i++)
+            next[i] = (j + i < K) ? window[j + i] : last.ahead[j + i - K];
+        return next;
+    }
+
+    static Window next_window(const Window & window, Node<K> & last) {
+        return window_at(window, K - 1, last);
+    }
+};
+
+};
+
+template <size_t K>
+struct LeaderRingWindow: public BocBenchmark {
+    static const inline std::string name = "leader_ring_window_" + std::to_string(K);
+
+    uint64_t servers;
+
+    // Needs at least K servers; the benchmarker skips windows wider than the ring.
+    LeaderRingWindow(uint64_t servers, uint64_t): servers(servers) {}
+
+    void run() {
+        using namespace leader_ring_window;
+        using N = leader_ring_window::Node<K>;
+        behaviours.reset();
+        std::vector<uint64_t> ids = gen_x_unique_randoms<uint64_t>(servers, std::max(servers*2, 65535ul));
+        when (make_cown<LeaderRingWindow<K>>(servers, 0)) << [=](acquired_cown<LeaderRingWindow<K>> ld) {
+            // Built from last to first, so every node is created with the nodes ahead of it.
+            // Only the last K - 1 nodes wrap around to nodes that do not exist yet, and get
+            // their window patched by one behaviour each before the election starts.
+            std::vector<cown_ptr<N>> server_list(servers);
+            for (uint64_t i = servers; i-- > 0;) {
+                std::array<cown_ptr<N>, K - 1> ahead;
+                for (size_t j = 0; j < K - 1; j++)
+                    ahead[j] = (i + 1 + j < servers) ? server_list[i + 1 + j] : cown_ptr<N>();
+                server_list[i] = make_cown<N>(ids[i], ahead);
+            }
+            for (uint64_t i = servers - (K - 1); i < servers; i++) {
+                std::array<cown_ptr<N>, K - 1> ahead;
+                for (size_t j = 0; j < K - 1; j++)
+                    ahead[j] = server_list[(i + 1 + j) % servers];
+                when (server_list[i]) << [=](acquired_cown<N> svr) {
+                    svr->ahead = ahead;
+                };
+            }
+
+            uint64_t start = gen_x_unique_randoms<uint64_t>(1, servers-1)[0];
+            typename N::Window window;
+            for (size_t j = 0; j < K; j++)
+                window[j] = server_list[(start + j) % servers];
+            N::share_ids(window);
+        };
+    }
+
+    std::vector<std::pair<std::string, double>> metrics() {
+        return {{"behaviours", (double)leader_ring_window::behaviours.total()}};
+    }
+};
+
+};
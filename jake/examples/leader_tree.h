@@ -14,25 +14,45 @@ typedef enum {
     Candidate
 } State;
 
-template <typename K>
-struct Counter {
-    K remaining;
-    std::function<void()> on_complete;
-
-    Counter(K initial, std::function<void()> cb) : remaining(initial), on_complete(cb) {}
-
-    static void done(cown_ptr<Counter<K>> self) {
-        when(self) << [=](acquired_cown<Counter<K>> self) {
-            if (self->remaining == 0)
-                self->on_complete();
-        };
+// The shape of the tree is fixed before any node exists. Children are numbered in
+// breadth-first order from the per-node child counts, and every subtree owns a
+// contiguous preorder slice of the ids, so each subtree can be built on its own.
+struct TreeShape {
+    std::vector<uint64_t> first_child;
+    std::vector<uint64_t> num_children;
+    std::vector<uint64_t> subtree_size;
+    std::vector<uint64_t> first_id;
+
+    // PRE: sum(children_per_node) == nodes - 1, and every entry is at least 1
+    TreeShape(uint64_t nodes, const std::vector<uint64_t> & children_per_node):
+        first_child(nodes, 0), num_children(nodes, 0), subtree_size(nodes, 1), first_id(nodes, 0) {
+        uint64_t next = 1;
+        for (uint64_t i = 0; i < children_per_node.size() && next < nodes; i++) {
+            first_child[i] = next;
+            num_children[i] = std::min(children_per_node[i], nodes - next);
+            next += num_children[i];
+        }
+        // children always have a higher index than their parent
+        for (uint64_t i = nodes; i-- > 0;) {
+            for (uint64_t c = 0; c < num_children[i]; c++)
+                subtree_size[i] += subtree_size[first_child[i] + c];
+        }
+        for (uint64_t i = 0; i < nodes; i++) {
+            uint64_t offset = first_id[i] + 1;
+            for (uint64_t c = 0; c < num_children[i]; c++) {
+                first_id[first_child[i] + c] = offset;
+                offset += subtree_size[first_child[i] + c];
+            }
+        }
     }
+};
 
-    static void add(cown_ptr<Counter<K>> self, K n = 1) {
-        when(self) << [=](acquired_cown<Counter<K>> self) {
-            self->remaining -= n;
-        };
-    }
+struct TreeBuild {
+    TreeShape shape;
+    std::vector<uint64_t> ids;
+
+    TreeBuild(std::vector<uint64_t> ids, const std::vector<uint64_t> & children_per_node):
+        shape(ids.size(), children_per_node), ids(std::move(ids)) {}
 };
 
 struct Node {
@@ -42,19 +62,53 @@ struct Node {
     State state = Follower;
     uint64_t known_ids = 0;
     uint64_t highest_id;
+    uint64_t subtrees_pending = 0;
+
+    Node(uint64_t id): id(id), highest_id(id) {}
+
+    Node(uint64_t id, cown_ptr<Node> parent): id(id), highest_id(id), parent(parent) {}
+
+    // Creates the children of the node at `index` in the shape and builds their
+    // subtrees in parallel. Each node only touches itself, and completion is
+    // combined up the tree, so no behaviour acquires anything shared.
+    // The build is owned by the benchmark and outlives the run, so a plain pointer is
+    // shared instead of a refcount that every worker would write to.
+    static void build(const cown_ptr<Node> & self, uint64_t index, const TreeBuild * tree) {
+        when (self) << [=](acquired_cown<Node> self) {
+            ALLOC_TAG("leader_tree::build");
+            const TreeShape & shape = tree->shape;
+            self->subtrees_pending = shape.num_children[index];
+            if (self->subtrees_pending == 0) {
+                subtree_built(self);
+                return;
+            }
+            for (uint64_t c = 0; c < shape.num_children[index]; c++) {
+                uint64_t child = shape.first_child[index] + c;
+                cown_ptr<Node> n = make_cown<Node>(tree->ids[shape.first_id[child]], self.cown());
+                self->children.push_back(n);
+                build(n, child, tree);
+            }
+        };
+    }
 
-    Node(uint64_t id): id(id), highest_id(id) {
-        debug(" Made node with id : " , id);
+    static void subtree_built(acquired_cown<Node> & self) {
+        if (self->parent)
+            child_built(self->parent);
+        else
+            start(self.cown());
     }
 
-    Node(uint64_t id, cown_ptr<Node> parent): id(id), highest_id(id), parent(parent) {
-        when (parent) << [=](acquired_cown<Node> parent) {
-            debug(" Made node with id ", id, ": My parent is : ", parent->id);
+    static void child_built(const cown_ptr<Node> & self) {
+        when (self) << [=](acquired_cown<Node> self) {
+            ALLOC_TAG("leader_tree::child_built");
+            if (--self->subtrees_pending == 0)
+                subtree_built(self);
         };
     }
 
     static void start(const cown_ptr<Node> & self) {
         when (self) << [=](acquired_cown<Node> self) {
+            ALLOC_TAG("leader_tree::start");
             if (self->state != Candidate) {
                 self->state = Candidate;
                 if (self->parent)
@@ -71,6 +125,7 @@ struct Node {
 
     static void propagate_ids(const cown_ptr<Node> & self) {
         when(self) << [=](acquired_cown<Node> self) {
+            ALLOC_TAG("leader_tree::propagate_ids");
             //debug(" propagate : ", self->highest_id);
             if (self->state == Candidate)
                 receive_id(self->parent, self->highest_id);
@@ -79,6 +134,7 @@ struct Node {
 
     static void receive_id(const cown_ptr<Node> & self, uint64_t sender_id) {
         when(self) << [=](acquired_cown<Node> self) {
+            ALLOC_TAG("leader_tree::receive_id");
             //debug(" id : ", self->id, " -- recv prop from : ", sender_id);
             if (self->state == Candidate) {
                 self->highest_id = std::max(sender_id, self->highest_id);
@@ -96,6 +152,7 @@ struct Node {
 
     static void election_result(const cown_ptr<Node> & self, uint64_t sender_id) {
         when(self) << [=](acquired_cown<Node> self) {
+            ALLOC_TAG("leader_tree::election_result");
             if (self->state == Candidate) {
                 self->highest_id = sender_id;
                 declare_leader(self.cown());
@@ -105,6 +162,7 @@ struct Node {
 
     static void declare_leader(const cown_ptr<Node> & self) {
         when(self) << [=](acquired_cown<Node> self) {
+            ALLOC_TAG("leader_tree::declare_leader");
             debug(" Leader elected with id : ", self->highest_id);
             if (self->state == Candidate) {
                 self->state = (self->id == self->highest_id) ? Leader : Follower;
@@ -120,51 +178,16 @@ struct Node {
 struct LeaderTree: public ActorBenchmark {
     uint64_t servers;
     uint64_t max_nodes_per_layer;
+    std::unique_ptr<leader_tree::TreeBuild> tree;
     
     LeaderTree(uint64_t servers, uint64_t max_nodes_per_layer): servers(servers), max_nodes_per_layer(max_nodes_per_layer) {} 
 
-    template <typename K>
-    void init_children(cown_ptr<leader_tree::Node> parent, 
-                    cown_ptr<std::vector<K>> children_per_node, 
-                    cown_ptr<std::vector<K>> ids, 
-                    cown_ptr<leader_tree::Counter<K>> counter) {
-        using namespace leader_tree;
-        when (children_per_node, parent, ids) << [=](
-                    acquired_cown<std::vector<K>> children_per_node_list, 
-                    acquired_cown<leader_tree::Node> parent, 
-                    acquired_cown<std::vector<K>> id_list) {
-            if (id_list->empty()) {
-                Counter<K>::done(counter);
-            } else {
-                K num_children = children_per_node_list->back();
-                children_per_node_list->pop_back();
-                for (K i = 0; i < num_children; i++) {
-                    cown_ptr<leader_tree::Node> c = make_cown<leader_tree::Node>(id_list->back(), parent.cown());
-                    parent->children.push_back(c);
-                    id_list->pop_back();
-                    Counter<K>::add(counter);
-                    init_children<K>(c, children_per_node, ids, counter);     
-                }
-            }
-        };
-    }
-
     void run() {
         using namespace leader_tree;
-        cown_ptr<std::vector<uint64_t>> ids = make_cown<std::vector<uint64_t>>(gen_x_unique_randoms<uint64_t>(servers));
-        when (make_cown<LeaderTree>(servers, max_nodes_per_layer)) << [=](acquired_cown<LeaderTree> ld) {
-            cown_ptr<std::vector<uint64_t>> children_per_node = make_cown<std::vector<uint64_t>>(divide_randomly(servers-1, max_nodes_per_layer));
-            // PRE: sum(children_per_node) == ids.size
-            when (ids) << [=](acquired_cown<std::vector<uint64_t>> ids) mutable {
-                // INV: children_per_node.size == 0 ==> ids.size == 0
-                cown_ptr<leader_tree::Node> root = make_cown<leader_tree::Node>(ids->back());
-                ids->pop_back();
-                cown_ptr<Counter<uint64_t>> counter = make_cown<Counter<uint64_t>>(servers-1, [=]() {
-                    Node::start(root);
-                });
-                init_children<uint64_t>(root, children_per_node, ids.cown(), counter);
-            };
-        };
+        tree = std::make_unique<TreeBuild>(
+            gen_x_unique_randoms<uint64_t>(servers, std::max(servers*2, 65535ul)), divide_randomly<uint64_t>(servers-1, max_nodes_per_layer));
+        cown_ptr<leader_tree::Node> root = make_cown<leader_tree::Node>(tree->ids[0]);
+        Node::build(root, 0, tree.get());
     }
 };
 
@@ -0,0 +1,213 @@
+#include "util/bench.h"
+#include "util/counter.h"
+#include "../mailbox.h"
+#include "../safe_print.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <queue>
+
+namespace jake_benchmark {
+
+// Compares TypedMailbox with the mailbox the experimental elections use, a
+// std::queue of shared_ptr<Message> filled with make_shared and dispatched by
+// dynamic_pointer_cast. Every mailbox is a cown that receives batches of votes, pings
+// and the odd log snapshot, each batch followed by a behaviour that drains it, which is
+// the recv / handle_mail pattern of generic_leader.h.
+namespace mailbox_bench {
+
+static constexpr size_t BATCH = 64;
+// one message in SNAPSHOT_EVERY is a large payload
+static constexpr size_t SNAPSHOT_EVERY = 16;
+
+struct Ping {
+    uint64_t from;
+    uint64_t value;
+};
+
+struct Vote {
+    uint64_t term;
+    uint64_t candidate;
+    bool granted;
+};
+
+struct Snapshot {
+    std::array<uint64_t, 32> log;
+};
+
+// Counts what goes through it, so the baseline's allocations can be attributed
+// exactly even though operator new belongs to snmalloc.
+inline ShardedCounter allocations;
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U> &) {}
+
+    T * allocate(size_t n) {
+        allocations.add();
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T * p, size_t n) {
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U> &) const { return true; }
+
+    template <typename U>
+    bool operator!=(const CountingAllocator<U> &) const { return false; }
+};
+
+struct Legacy {
+    static constexpr const char* name = "shared_ptr";
+
+    struct Message {
+        virtual ~Message() = default;
+    };
+
+    struct PingMessage: public Message {
+        Ping ping;
+        PingMessage(Ping ping): ping(ping) {}
+    };
+
+    struct VoteMessage: public Message {
+        Vote vote;
+        VoteMessage(Vote vote): vote(vote) {}
+    };
+
+    struct SnapshotMessage: public Message {
+        Snapshot snapshot;
+        SnapshotMessage(Snapshot snapshot): snapshot(snapshot) {}
+    };
+
+    struct Mailbox {
+        std::queue<std::shared_ptr<Message>, std::deque<std::shared_ptr<Message>, CountingAllocator<std::shared_ptr<Message>>>> messages;
+        uint64_t checksum = 0;
+    };
+
+    template <typename T, typename... Args>
+    static void send(Mailbox & mailbox, Args&&... args) {
+        mailbox.messages.push(std::allocate_shared<T>(CountingAllocator<T>(), std::forward<Args>(args)...));
+    }
+
+    static void send_ping(Mailbox & mailbox, Ping ping) { send<PingMessage>(mailbox, ping); }
+    static void send_vote(Mailbox & mailbox, Vote vote) { send<VoteMessage>(mailbox, vote); }
+    static void send_snapshot(Mailbox & mailbox, const Snapshot & snapshot) { send<SnapshotMessage>(mailbox, snapshot); }
+
+    static size_t drain(Mailbox & mailbox) {
+        size_t handled = 0;
+        while (!mailbox.messages.empty()) {
+            std::shared_ptr<Message> msg = mailbox.messages.front();
+            mailbox.messages.pop();
+            if (auto ping = std::dynamic_pointer_cast<PingMessage>(msg))
+                mailbox.checksum += ping->ping.value;
+            else if (auto vote = std::dynamic_pointer_cast<VoteMessage>(msg))
+                mailbox.checksum += vote->vote.granted ? vote->vote.candidate : 0;
+            else if (auto snapshot = std::dynamic_pointer_cast<SnapshotMessage>(msg))
+                mailbox.checksum += snapshot->snapshot.log[31];
+            handled++;
+        }
+        return handled;
+    }
+
+    static size_t allocated(const Mailbox &) { return 0; }
+};
+
+struct Typed {
+    static constexpr const char* name = "typed";
+
+    struct Mailbox {
+        TypedMailbox<Ping, Vote, Pooled<Snapshot>> messages;
+        uint64_t checksum = 0;
+    };
+
+    static void send_ping(Mailbox & mailbox, Ping ping) { mailbox.messages.push(ping); }
+    static void send_vote(Mailbox & mailbox, Vote vote) { mailbox.messages.push(vote); }
+    static void send_snapshot(Mailbox & mailbox, const Snapshot & snapshot) { mailbox.messages.push_pooled<Snapshot>(snapshot); }
+
+    static size_t drain(Mailbox & mailbox) {
+        return mailbox.messages.drain(overloaded {
+            [&](Ping & ping) { mailbox.checksum += ping.value; },
+            [&](Vote & vote) { mailbox.checksum += vote.granted ? vote.candidate : 0; },
+            [&](Pooled<Snapshot> & snapshot) { mailbox.checksum += snapshot->log[31]; }
+        });
+    }
+
+    static size_t allocated(const Mailbox & mailbox) { return mailbox.messages.allocations(); }
+};
+
+};
+
+template <typename Impl>
+struct MailboxBench: public AsyncBenchmarkBase {
+    using Mailbox = typename Impl::Mailbox;
+
+    static const inline std::string name = std::string("mailbox_") + Impl::name;
+
+    uint64_t mailboxes;
+    uint64_t messages;
+    std::atomic<uint64_t> pending;
+    std::atomic<uint64_t> allocated;
+    std::chrono::high_resolution_clock::time_point begin;
+    double elapsed_s = 0;
+
+    MailboxBench(uint64_t mailboxes, uint64_t messages): mailboxes(mailboxes), messages(messages) {}
+
+    std::string paradigm() { return "actor"; }
+
+    void run() {
+        using namespace mailbox_bench;
+        allocations.reset();
+        pending = mailboxes;
+        allocated = 0;
+        begin = std::chrono::high_resolution_clock::now();
+        uint64_t batches = (messages + BATCH - 1) / BATCH;
+        for (uint64_t m = 0; m < mailboxes; m++) {
+            cown_ptr<Mailbox> mailbox = make_cown<Mailbox>();
+            for (uint64_t b = 0; b < batches; b++) {
+                when (mailbox) << [=](acquired_cown<Mailbox> mailbox) {
+                    for (uint64_t i = b * BATCH; i < std::min((b + 1) * BATCH, messages); i++) {
+                        if (i % SNAPSHOT_EVERY == 0) {
+                            Snapshot snapshot;
+                            snapshot.log.fill(i);
+                            Impl::send_snapshot(*mailbox, snapshot);
+                        }
+                        else if (i % 2 == 0)
+                            Impl::send_vote(*mailbox, Vote{ b, i, (i & 4) != 0 });
+                        else
+                            Impl::send_ping(*mailbox, Ping{ m, i });
+                    }
+                };
+                when (mailbox) << [=](acquired_cown<Mailbox> mailbox) {
+                    Impl::drain(*mailbox);
+                    if (b + 1 == batches)
+                        finished(*mailbox);
+                };
+            }
+        }
+    }
+
+    void finished(Mailbox & mailbox) {
+        allocated += Impl::allocated(mailbox);
+        if (--pending == 0)
+            elapsed_s = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    }
+
+    std::vector<std::pair<std::string, double>> metrics() {
+        double total = (double)(mailboxes * messages);
+        double allocs = (double)(allocated + mailbox_bench::allocations.total());
+        return {
+            {"messages_per_sec", elapsed_s > 0 ? total / elapsed_s : 0},
+            {"allocations_per_message", total > 0 ? allocs / total : 0}
+        };
+    }
+};
+
+};
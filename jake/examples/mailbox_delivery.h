@@ -0,0 +1,204 @@
+#include "util/bench.h"
+#include "util/counter.h"
+#include "util/histogram.h"
+#include "../mailbox.h"
+#include "../rng.h"
+#include "../safe_print.h"
+#include <atomic>
+#include <chrono>
+#include <sys/resource.h>
+
+namespace jake_benchmark {
+
+// Chang and Roberts on a ring where every node has a mailbox cown next to it, as in
+// generic_leader.h, to compare two ways of getting mail from the mailbox to the node:
+//
+//  - Polling is check_mail / handle_mail: a behaviour on the node, then one on node and
+//    mailbox that drains whatever is there and schedules the next check, forever, until
+//    the node has learnt who the leader is and drained its mailbox one last time,
+//  - EventDriven is EventMailbox: the drain is only scheduled when mail arrives at an
+//    idle mailbox.
+namespace mailbox_delivery {
+
+// Every message carries a stopwatch started when it is sent, and stopped when the
+// node handles it, into the delivery latency sketch.
+struct Probe {
+    uint64_t id;
+    Stopwatch sent;
+};
+
+struct Elected {
+    uint64_t id;
+    Stopwatch sent;
+};
+
+// Messages that arrive at a polling node after its last drain are never delivered,
+// so costs are per message posted, which is the same work for both.
+inline ShardedCounter posted;
+inline ShardedCounter delivered;
+inline ShardedCounter polls;
+inline std::atomic<int64_t> settled_ns;
+inline ShardedHistogram delivery_ns;
+
+template <typename Delivery>
+struct Node {
+    using Mailbox = typename Delivery::Mailbox;
+
+    struct Address {
+        using Owner = Node;
+        cown_ptr<Node> node;
+        cown_ptr<Mailbox> mailbox;
+    };
+
+    uint64_t id;
+    Address next;
+    bool decided = false;
+    uint64_t leader = 0;
+
+    Node(uint64_t id): id(id) {}
+
+    static void start(const Address & self) {
+        Delivery::start(self);
+        when (self.node) << [=](acquired_cown<Node> node) {
+            Delivery::send(node->next, Probe{ node->id });
+        };
+    }
+
+    static void handle(acquired_cown<Node> & node, Probe & probe) {
+        delivered.add();
+        probe.sent.stop(delivery_ns);
+        if (probe.id > node->id)
+            Delivery::send(node->next, probe);
+        else if (probe.id == node->id) {
+            debug("Node ", node->id, " became leader");
+            Delivery::send(node->next, Elected{ node->id });
+        }
+    }
+
+    static void handle(acquired_cown<Node> & node, Elected & elected) {
+        delivered.add();
+        elected.sent.stop(delivery_ns);
+        node->decided = true;
+        node->leader = elected.id;
+        if (elected.id != node->id)
+            Delivery::send(node->next, elected);
+        else
+            settled_ns = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    }
+};
+
+struct Polling {
+    static constexpr const char* name = "polling";
+
+    using Mailbox = TypedMailbox<Probe, Elected>;
+
+    template <typename Address, typename M>
+    static void send(const Address & to, M msg) {
+        posted.add();
+        msg.sent = Stopwatch();
+        when (to.mailbox) << [=](acquired_cown<Mailbox> mailbox) {
+            mailbox->push(msg);
+        };
+    }
+
+    template <typename Address>
+    static void start(const Address & self) {
+        check_mail(self);
+    }
+
+    template <typename Address>
+    static void check_mail(const Address & self) {
+        using N = typename Address::Owner;
+        when (self.node) << [=](acquired_cown<N> node) {
+            polls.add();
+            bool last = node->decided;
+            when (self.node, self.mailbox) << [=](acquired_cown<N> node, acquired_cown<Mailbox> mailbox) {
+                mailbox->drain([&](auto & m) { N::handle(node, m); });
+                if (!last)
+                    check_mail(self);
+            };
+        };
+    }
+};
+
+struct EventDriven {
+    static constexpr const char* name = "event";
+
+    using Mailbox = EventMailbox<Probe, Elected>;
+
+    template <typename Address, typename M>
+    static void send(const Address & to, M msg) {
+        posted.add();
+        msg.sent = Stopwatch();
+        Mailbox::post(to.mailbox, to.node, msg);
+    }
+
+    template <typename Address>
+    static void start(const Address &) {}
+};
+
+};
+
+template <typename Delivery>
+struct MailboxDelivery: public ActorBenchmark {
+    using Node = mailbox_delivery::Node<Delivery>;
+    using Mailbox = typename Delivery::Mailbox;
+
+    static const inline std::string name = std::string("mailbox_delivery_") + Delivery::name;
+
+    uint64_t servers;
+    double cpu_begin_us = 0;
+
+    MailboxDelivery(uint64_t servers, uint64_t): servers(servers) {}
+
+    static double cpu_us() {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    }
+
+    void run() {
+        using namespace mailbox_delivery;
+        posted.reset();
+        delivered.reset();
+        polls.reset();
+        delivery_ns.reset();
+        settled_ns = 0;
+        cpu_begin_us = cpu_us();
+        std::vector<uint64_t> ids = gen_x_unique_randoms<uint64_t>(servers, std::max(servers*2, 65535ul));
+        when (make_cown<uint64_t>(servers)) << [=](acquired_cown<uint64_t>) {
+            std::vector<typename Node::Address> addresses(servers);
+            for (uint64_t i = 0; i < servers; i++)
+                addresses[i] = { make_cown<Node>(ids[i]), make_cown<Mailbox>() };
+            for (uint64_t i = 0; i < servers; i++) {
+                typename Node::Address next = addresses[(i + 1) % servers];
+                when (addresses[i].node) << [=](acquired_cown<Node> node) {
+                    node->next = next;
+                };
+            }
+            for (auto const& address : addresses)
+                Node::start(address);
+        };
+    }
+
+    // Called once the scheduler has run out of work, so the time since the leader
+    // learnt of its own election is how long the runtime took to go quiescent.
+    std::vector<std::pair<std::string, double>> metrics() {
+        using namespace mailbox_delivery;
+        double cpu = cpu_us() - cpu_begin_us;
+        int64_t now = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+        uint64_t messages = posted.total();
+        std::vector<std::pair<std::string, double>> result = {
+            {"posted", (double)messages},
+            {"undelivered", (double)(messages - delivered.total())},
+            {"polls", (double)polls.total()},
+            {"cpu_us_per_message", messages > 0 ? cpu / messages : 0},
+            {"quiescence_ms", settled_ns > 0 ? (double)(now - settled_ns) / 1e6 : 0}
+        };
+        for (auto & metric : delivery_ns.metrics("delivery_us_", 1e3))
+            result.push_back(metric);
+        return result;
+    }
+};
+
+};
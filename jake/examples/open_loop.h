@@ -0,0 +1,158 @@
+#include "util/bench.h"
+#include "util/cowns.h"
+#include "util/load.h"
+#include "util/topology.h"
+#include "kitchen.h"
+#include "../safe_print.h"
+#include <unordered_map>
+
+namespace jake_benchmark {
+
+// Requests for the open-loop generator. A target sets itself up once per run and
+// then turns request i into behaviours, calling `done()` when the request is over.
+namespace open_loop {
+
+// Gets and puts, one in ten a put, on a key-value store split over cown shards.
+struct KeyValue {
+    static constexpr const char* name = "kv";
+    static constexpr uint64_t KEYS = 1 << 20;
+
+    struct Shard {
+        std::unordered_map<uint64_t, uint64_t> map;
+    };
+
+    size_t shards;
+    std::vector<cown_ptr<Shard>> store;
+
+    KeyValue(size_t shards): shards(std::max<size_t>(shards, 1)) {}
+
+    void setup() {
+        store.clear();
+        for (size_t i = 0; i < shards; i++)
+            store.push_back(make_cown<Shard>());
+    }
+
+    template <typename Done>
+    void issue(uint64_t i, Done done) {
+        uint64_t x = i;
+        uint64_t key = topology::splitmix64(x) % KEYS;
+        bool put = i % 10 == 0;
+        when (store[key % shards]) << [=](acquired_cown<Shard> shard) {
+            if (put)
+                shard->map[key] = i;
+            else
+                shard->map.find(key);
+            done();
+        };
+    }
+};
+
+// A whole election per request: the highest id is carried around a fresh ring of
+// `size` nodes, one two-node behaviour per hop as in leader_ring_boc, until it
+// comes back to the node it belongs to.
+struct RingElection {
+    static constexpr const char* name = "election";
+
+    struct Node {
+        uint64_t id;
+        cown_ptr<Node> next;
+
+        Node(uint64_t id, cown_ptr<Node> next): id(id), next(next) {}
+    };
+
+    size_t size;
+
+    RingElection(size_t size): size(std::max<size_t>(size, 2)) {}
+
+    void setup() {}
+
+    template <typename Done>
+    void issue(uint64_t i, Done done) {
+        uint64_t seed = i;
+        std::vector<cown_ptr<Node>> ring = make_ring<Node>(size, [&](size_t, cown_ptr<Node> next) {
+            return std::make_tuple(topology::splitmix64(seed), next);
+        });
+        when (ring[0]) << [=](acquired_cown<Node> first) {
+            hop(ring[0], first->next, first->id, done);
+        };
+    }
+
+    template <typename Done>
+    static void hop(cown_ptr<Node> from, cown_ptr<Node> to, uint64_t highest, Done done) {
+        when (from, to) << [=](acquired_cown<Node>, acquired_cown<Node> node) {
+            if (node->id == highest) {
+                done();
+                return;
+            }
+            hop(to, node->next, std::max(highest, node->id), done);
+        };
+    }
+};
+
+// A breakfast per request, cooked as the kitchen benchmark cooks its orders, on
+// shared pans and toasters. Cooking is waited out on the real clock, since the
+// latencies are real, so it wants a --time-scale that brings the cooking times
+// near the gap between requests.
+struct BreakfastOrder {
+    static constexpr const char* name = "orders";
+
+    kitchen::Config config;
+    cown_ptr<kitchen::PanSpaces> pans;
+    cown_ptr<kitchen::Toasters> toasters;
+
+    BreakfastOrder(kitchen::Config config): config(config) {}
+
+    void setup() {
+        pans = kitchen::make_pans(config);
+        toasters = kitchen::make_toasters(config);
+    }
+
+    template <typename Done>
+    void issue(uint64_t i, Done done) {
+        uint64_t x = config.seed + i;
+        XorOshiro128Plus rand(topology::splitmix64(x));
+        kitchen::prepare(kitchen::draw(rand, i), pans, toasters, done);
+    }
+};
+
+};
+
+template <typename Target>
+struct OpenLoop: public AsyncBenchmarkBase {
+    static const inline std::string name = std::string("open_loop_") + Target::name;
+
+    Target target;
+    load::Schedule schedule;
+    load::Recorder recorder;
+    load::Generator generator;
+
+    OpenLoop(Target target, load::Schedule schedule): target(target), schedule(schedule) {}
+
+    std::string paradigm() { return "boc"; }
+
+    void run() {
+        target.setup();
+        load::Clock::time_point origin = load::Clock::now();
+        recorder.reset(origin);
+        generator.start(origin, schedule.offsets(), [this](size_t i, load::Clock::time_point intended) {
+            target.issue(i, [this, intended]() { recorder.done(intended); });
+        });
+    }
+
+    // Latencies are in microseconds, from each request's intended start.
+    std::vector<std::pair<std::string, double>> metrics() {
+        generator.join();
+        std::unique_ptr<Histogram> merged = recorder.latency.merged();
+        const Histogram & latency = *merged;
+        return {
+            {"offered_per_s", schedule.rate},
+            {"achieved_per_s", recorder.throughput()},
+            {"p50_us", latency.quantile(0.5) / 1e3},
+            {"p99_us", latency.quantile(0.99) / 1e3},
+            {"p999_us", latency.quantile(0.999) / 1e3},
+            {"max_us", latency.max() / 1e3}
+        };
+    }
+};
+
+};
@@ -1,8 +1,10 @@
 #include "util/bench.h"
 #include "util/random.h"
+#include "util/cowns.h"
 #include "../../typecheck.h"
 #include "../../rng.h"
 #include "../../safe_print.h"
+#include <atomic>
 #include <chrono>
 
 #define TIMEPOINT std::chrono::time_point<std::chrono::high_resolution_clock>
@@ -29,6 +31,9 @@ struct Node {
     Node(uint64_t id, cown_ptr<jake_benchmark::LeaderRingBoCTimed> ld): id(id), highest_id(id), ld(ld) {
     }
 
+    Node(uint64_t id, cown_ptr<Node> next, cown_ptr<jake_benchmark::LeaderRingBoCTimed> ld): id(id), highest_id(id), next(next), ld(ld) {
+    }
+
     static void share_ids(const cown_ptr<Node> & self, const cown_ptr<Node> & next) {
         when (self, next) << [=](acquired_cown<Node> self, acquired_cown<Node> next) {
             self->state = Candidate;
@@ -66,37 +71,21 @@ struct Node {
 struct LeaderRingBoCTimed {
     TIMEPOINT start;
     uint64_t servers;
+    // Time from the first message to the leader learning it won, in nanoseconds.
+    static inline std::atomic<int64_t> elapsed_ns{0};
+
     void finish(TIMEPOINT time) {
-        auto ms = std::chrono::duration_cast<std::chrono::nanoseconds>(time - start);
-        debug("boc: ", ms.count());
-        std::exit(0);
+        elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time - start).count();
     }
 
     LeaderRingBoCTimed(uint64_t servers): servers(servers) {} 
     static void make(uint64_t servers, std::vector<uint64_t> & ids, uint64_t starter) {
         using namespace leader_ring_boc_timed;
         when (make_cown<LeaderRingBoCTimed>(servers)) << [=](acquired_cown<LeaderRingBoCTimed> ld) {
-            std::vector<cown_ptr<leader_ring_boc_timed::Node>> server_list;
-            cown_ptr<uint64_t> completed = make_cown<uint64_t>(0);
-            for (uint64_t i = 0; i < servers; i++) {
-                server_list.emplace_back(make_cown<Node>(ids[i], ld.cown()));
-            }
-            for (uint64_t i = 0; i < servers - 1; i++) {
-                when (server_list[i], completed) << [next=server_list[i + 1]](auto svr, auto completed) {
-                    svr->next = next;
-                    completed++;
-                };
-            }
-            when (server_list[servers - 1], completed) << [first=server_list[0]](auto svr, auto completed) {
-                svr->next = first;
-                completed++;
-            };
-            when (completed, ld.cown()) << [=](auto completed, auto ld) {
-                if (completed == servers) {
-                    ld->start = std::chrono::high_resolution_clock::now();
-                    Node::share_ids(server_list[starter], server_list[starter + 1]);
-                }
-            };
+            std::vector<cown_ptr<leader_ring_boc_timed::Node>> server_list = make_ring<Node>(servers,
+                [&](uint64_t i, cown_ptr<Node> next) { return std::make_tuple(ids[i], next, ld.cown()); });
+            ld->start = std::chrono::high_resolution_clock::now();
+            Node::share_ids(server_list[starter], server_list[starter + 1]);
         };
     }
 };
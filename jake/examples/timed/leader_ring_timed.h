@@ -1,8 +1,10 @@
 #include "util/bench.h"
 #include "util/random.h"
+#include "util/cowns.h"
 #include "../../typecheck.h"
 #include "../../rng.h"
 #include "../../safe_print.h"
+#include <atomic>
 #include <chrono>
 
 #define TIMEPOINT std::chrono::time_point<std::chrono::high_resolution_clock>
@@ -29,6 +31,9 @@ struct Node {
         //debug(" Made Node with id : ", id);
     }
 
+    Node(uint64_t id, cown_ptr<Node> next, cown_ptr<jake_benchmark::LeaderRingTimed> ld): id(id), next(next), ld(ld) {
+    }
+
     static void propagate_id(const cown_ptr<Node> & self, uint64_t message_id) {
         when (self) << [=, tag=self](acquired_cown<Node> self) {
             self->state = Candidate;
@@ -65,34 +70,20 @@ struct LeaderRingTimed {
     TIMEPOINT start;
     LeaderRingTimed(uint64_t servers): servers(servers) {} 
 
+    // Time from the first message to the leader learning it won, in nanoseconds.
+    static inline std::atomic<int64_t> elapsed_ns{0};
+
     void finish(TIMEPOINT time) {
-        auto ms = std::chrono::duration_cast<std::chrono::nanoseconds>(time - start);
-        debug("act: ", ms.count());
-        std::exit(0);
+        elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time - start).count();
     }
 
     static void make(uint64_t servers, std::vector<uint64_t> & ids, uint64_t starter) {
         using namespace leader_ring_timed;
         when (make_cown<LeaderRingTimed>(servers)) << [=](acquired_cown<LeaderRingTimed> ld) {
-            std::vector<cown_ptr<leader_ring_timed::Node>> server_list;
-            cown_ptr<uint64_t> completed = make_cown<uint64_t>(0);
-            for (uint64_t i = 0; i < servers; i++) {
-                server_list.emplace_back(make_cown<Node>(ids[i], ld.cown()));
-            }
-            for (uint64_t i = 0; i < servers - 1; i++) {
-                when (server_list[i], completed) << [next=server_list[i + 1]](auto svr, auto completed) {
-                    svr->next = next;
-                    completed++;
-                };
-            }
-            when (server_list[servers - 1], completed) << [first=server_list[0]](auto svr, auto completed) {
-                svr->next = first;
-                completed++;
-            };
-            when (completed, ld.cown()) << [=](auto completed, auto ld) {
-                ld->start = std::chrono::high_resolution_clock::now();
-                Node::propagate_id(server_list[starter], 0);
-            };
+            std::vector<cown_ptr<leader_ring_timed::Node>> server_list = make_ring<Node>(servers,
+                [&](uint64_t i, cown_ptr<Node> next) { return std::make_tuple(ids[i], next, ld.cown()); });
+            ld->start = std::chrono::high_resolution_clock::now();
+            Node::propagate_id(server_list[starter], 0);
         };
     }
 };
@@ -3,44 +3,63 @@
 #include "leader_ring_timed.h"
 #include "leader_ring_boc_timed.h"
 #include <chrono>
-#include <unistd.h>
-#include <sys/types.h>
-#include <sys/wait.h>
 
 namespace jake_benchmark {
 
-struct TimedBench: public BocBenchmark {
+namespace timed {
+
+// The input both sides of the comparison run on: the same ring of ids, entered at
+// the same node, drawn once and shared by every pair of runs.
+struct Ring {
     uint64_t servers;
-    uint64_t repetitions;
-    TimedBench(uint64_t servers, uint64_t repetitions): servers(servers), repetitions(repetitions) {}
+    std::vector<uint64_t> ids;
+    uint64_t start;
+
+    Ring(uint64_t servers):
+        servers(servers),
+        ids(gen_x_unique_randoms<uint64_t>(servers, std::max(servers*2, 65535ul))),
+        start(gen_x_unique_randoms<uint64_t>(1, servers-2)[0]) {}
+};
+
+struct Actor {
+    static constexpr const char* name = "actor";
+    using Election = LeaderRingTimed;
+};
+
+struct BoC {
+    static constexpr const char* name = "boc";
+    using Election = LeaderRingBoCTimed;
+};
+
+};
+
+// One election on a timed::Ring, reporting how long it took from the first message
+// to the leader knowing, next to the harness's time for the whole run.
+template <typename Paradigm>
+struct TimedRing: public AsyncBenchmarkBase {
+    using Election = typename Paradigm::Election;
+
+    static const inline std::string name = std::string("leader_ring_timed_") + Paradigm::name;
+
+    const timed::Ring & ring;
+
+    TimedRing(const timed::Ring & ring): ring(ring) {}
+
+    std::string paradigm() { return Paradigm::name; }
+
     void run() {
-        std::vector<uint64_t> ids;
-        std::vector<uint64_t> starts;
-        for (uint64_t i = 0; i < repetitions; i++) {
-            ids = gen_x_unique_randoms<uint64_t>(servers, std::max(servers*2, 65535ul));
-            starts = gen_x_unique_randoms<uint64_t>(1, servers-2);
-
-            for (uint64_t i = 0; i < repetitions; i++) {
-                pid_t p = fork();
-                if (p == 0) {
-                    using namespace leader_ring_timed;
-                    LeaderRingTimed::make(servers, ids, starts[0]);
-                }
-                else {
-                    waitpid(p, NULL, 0);
-                }
-            }
-            for (uint64_t i = 0; i < repetitions; i++) {
-                pid_t p = fork();
-                if (p == 0) {
-                    using namespace leader_ring_boc_timed;
-                    LeaderRingBoCTimed::make(servers, ids, starts[0]);
-                }
-                else {
-                    waitpid(p, NULL, 0);
-                }
-            }
-        }
+        std::vector<uint64_t> ids = ring.ids;
+        Election::elapsed_ns = 0;
+        Election::make(ring.servers, ids, ring.start);
     }
+
+    std::vector<std::pair<std::string, double>> metrics() {
+        return {{"election_us", (double)Election::elapsed_ns / 1e3}};
+    }
+};
+
+// Actor against BoC on the same ring, run in alternation and compared pair by pair.
+using TimedActor = TimedRing<timed::Actor>;
+using TimedBoC = TimedRing<timed::BoC>;
+
 };
-};
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <memory>
+#include <utility>
+
+// Memory layouts for a cown payload made of hot fields, touched by every message,
+// and cold ones, touched rarely. A node type picks a layout by deriving from
+// `Layout::Storage<Hot, Cold>` and reaches its fields through hot() and cold(), so
+// the same election can be run over each of them:
+//
+//  - Packed keeps both inline at their natural alignment. Payloads are as small as
+//    they can be, and since make_ring creates the cowns one after another,
+//    the hot fields of neighbouring cowns, which different workers may be writing
+//    at the same time, can end up on one cache line,
+//  - Padded aligns the payload to a cache line and rounds its size up to whole
+//    lines, so no two cowns share one, at the cost of memory and density,
+//  - Split keeps the hot fields inline and moves the cold ones out of line behind
+//    a pointer, so the cown stays small and a message only pulls in the lines
+//    that it actually uses.
+namespace layout {
+
+constexpr size_t CACHE_LINE = 64;
+
+struct Packed {
+    static constexpr const char* name = "packed";
+
+    template <typename Hot, typename Cold>
+    struct Storage {
+        Hot hot_data;
+        Cold cold_data;
+
+        template <typename... Args>
+        Storage(Args&&... args): hot_data{std::forward<Args>(args)...} {}
+
+        Hot & hot() { return hot_data; }
+        Cold & cold() { return cold_data; }
+    };
+};
+
+struct Padded {
+    static constexpr const char* name = "padded";
+
+    template <typename Hot, typename Cold>
+    struct alignas(CACHE_LINE) Storage {
+        Hot hot_data;
+        Cold cold_data;
+
+        template <typename... Args>
+        Storage(Args&&... args): hot_data{std::forward<Args>(args)...} {}
+
+        Hot & hot() { return hot_data; }
+        Cold & cold() { return cold_data; }
+    };
+};
+
+struct Split {
+    static constexpr const char* name = "split";
+
+    template <typename Hot, typename Cold>
+    struct Storage {
+        Hot hot_data;
+        std::unique_ptr<Cold> cold_data = std::make_unique<Cold>();
+
+        template <typename... Args>
+        Storage(Args&&... args): hot_data{std::forward<Args>(args)...} {}
+
+        Hot & hot() { return hot_data; }
+        Cold & cold() { return *cold_data; }
+    };
+};
+
+};
+
+#endif // LAYOUT_H
@@ -0,0 +1,213 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <cpp/when.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// A handle to a message payload that lives in its mailbox's slab pool rather than
+// inline in the queue. Worth it for payloads too big to copy around in a variant.
+template <typename T>
+struct Pooled {
+    T * ptr = nullptr;
+
+    T & operator*() const { return *ptr; }
+    T * operator->() const { return ptr; }
+};
+
+// Fixed-size objects carved out of slabs that are never returned until the pool dies,
+// so after warm-up a payload costs a free-list pop and push instead of an allocation.
+template <typename T, size_t SLAB = 64>
+struct SlabPool {
+    union Slot {
+        Slot * next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    Slot * free_list = nullptr;
+
+    template <typename... Args>
+    T * make(Args&&... args) {
+        if (free_list == nullptr) {
+            slabs.emplace_back(new Slot[SLAB]);
+            Slot * slab = slabs.back().get();
+            for (size_t i = 0; i < SLAB; i++) {
+                slab[i].next = free_list;
+                free_list = &slab[i];
+            }
+        }
+        Slot * slot = free_list;
+        free_list = slot->next;
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    void release(T * value) {
+        value->~T();
+        Slot * slot = reinterpret_cast<Slot *>(value);
+        slot->next = free_list;
+        free_list = slot;
+    }
+
+    size_t allocations() const { return slabs.size(); }
+};
+
+namespace mailbox_detail {
+    struct NoPool {
+        size_t allocations() const { return 0; }
+    };
+
+    template <typename M>
+    struct PoolFor { using type = NoPool; };
+
+    template <typename T>
+    struct PoolFor<Pooled<T>> { using type = SlabPool<T>; };
+};
+
+// A FIFO of messages of the listed types, stored inline as a std::variant in a
+// growable power-of-two ring buffer and dispatched with std::visit. Sending a message
+// does not allocate once the buffer has grown to its working size, and handlers
+// receive the concrete type directly, without a shared_ptr or a dynamic cast.
+//
+// A mailbox is meant to live inside a cown, so it is only ever used by one
+// behaviour at a time and needs no synchronisation of its own.
+template <typename... Msgs>
+struct TypedMailbox {
+    using Message = std::variant<std::monostate, Msgs...>;
+
+    std::vector<Message> ring;
+    size_t head = 0;
+    size_t count = 0;
+    size_t growths = 0;
+    std::tuple<typename mailbox_detail::PoolFor<Msgs>::type...> pools;
+
+    TypedMailbox(size_t capacity = 16) {
+        size_t c = 1;
+        while (c < capacity)
+            c <<= 1;
+        ring.resize(c);
+    }
+
+    bool empty() const { return count == 0; }
+
+    size_t size() const { return count; }
+
+    template <typename M>
+    void push(M && msg) {
+        if (count == ring.size())
+            grow();
+        ring[(head + count) & (ring.size() - 1)] = std::forward<M>(msg);
+        count++;
+    }
+
+    // Builds a T in the pool for Pooled<T> and queues a handle to it.
+    template <typename T, typename... Args>
+    void push_pooled(Args&&... args) {
+        constexpr size_t index = alternative<Pooled<T>>();
+        push(Pooled<T>{ std::get<index - 1>(pools).make(std::forward<Args>(args)...) });
+    }
+
+    // Hands the oldest message to `handler`, which must accept every message type.
+    // Pooled payloads go back to their pool once the handler returns.
+    template <typename F>
+    bool pop(F && handler) {
+        if (count == 0)
+            return false;
+        Message msg = std::move(ring[head]);
+        ring[head] = std::monostate();
+        head = (head + 1) & (ring.size() - 1);
+        count--;
+        std::visit([&](auto & m) {
+            using M = std::decay_t<decltype(m)>;
+            if constexpr (!std::is_same_v<M, std::monostate>)
+                handler(m);
+        }, msg);
+        release(msg, std::make_index_sequence<sizeof...(Msgs)>());
+        return true;
+    }
+
+    template <typename F>
+    size_t drain(F && handler) {
+        size_t handled = 0;
+        while (pop(handler))
+            handled++;
+        return handled;
+    }
+
+    // Heap allocations made so far: every ring growth and every pool slab.
+    size_t allocations() const {
+        return growths + std::apply([](auto const&... pool) { return (size_t(0) + ... + pool.allocations()); }, pools);
+    }
+
+  private:
+    template <typename M, size_t I = 1>
+    static constexpr size_t alternative() {
+        static_assert(I < std::variant_size_v<Message>, "not a message type of this mailbox");
+        if constexpr (std::is_same_v<std::variant_alternative_t<I, Message>, M>)
+            return I;
+        else
+            return alternative<M, I + 1>();
+    }
+
+    template <size_t... I>
+    void release(Message & msg, std::index_sequence<I...>) {
+        (release_one<I>(msg), ...);
+    }
+
+    template <size_t I>
+    void release_one(Message & msg) {
+        using M = std::variant_alternative_t<I + 1, Message>;
+        if constexpr (!std::is_same_v<typename mailbox_detail::PoolFor<M>::type, mailbox_detail::NoPool>) {
+            if (msg.index() == I + 1)
+                std::get<I>(pools).release(std::get<I + 1>(msg).ptr);
+        }
+    }
+
+    void grow() {
+        std::vector<Message> bigger(ring.size() * 2);
+        for (size_t i = 0; i < count; i++)
+            bigger[i] = std::move(ring[(head + i) & (ring.size() - 1)]);
+        ring.swap(bigger);
+        head = 0;
+        growths++;
+    }
+};
+
+// A TypedMailbox that lives in its own cown next to its owner and only schedules work
+// for the owner when there is something to handle. The first message to arrive at an
+// idle mailbox schedules one behaviour on owner and mailbox that drains everything
+// queued by then; later messages join that drain instead of scheduling their own. This
+// replaces the check_mail / handle_mail loops that reschedule themselves whether or
+// not anything has arrived, so a node with no mail costs nothing and the scheduler
+// can go quiescent.
+//
+// Owner must provide a static handle(acquired_cown<Owner> &, M &) for every message type.
+template <typename... Msgs>
+struct EventMailbox {
+    TypedMailbox<Msgs...> queue;
+    bool scheduled = false;
+
+    template <typename Owner, typename M>
+    static void post(const verona::cpp::cown_ptr<EventMailbox> & self, const verona::cpp::cown_ptr<Owner> & owner, M msg) {
+        using namespace verona::cpp;
+        when (self) << [=](acquired_cown<EventMailbox> mailbox) mutable {
+            mailbox->queue.push(std::move(msg));
+            if (mailbox->scheduled)
+                return;
+            mailbox->scheduled = true;
+            when (owner, self) << [](acquired_cown<Owner> owner, acquired_cown<EventMailbox> mailbox) {
+                mailbox->scheduled = false;
+                mailbox->queue.drain([&](auto & m) { Owner::handle(owner, m); });
+            };
+        };
+    }
+};
+
+#endif // MAILBOX_H
@@ -8,7 +8,10 @@ template <typename K>
 std::vector<K> gen_x_unique_randoms(K x, K max = 65535) {
     static_assert(std::is_integral<K>::value &&
         std::is_unsigned<K>::value, "K must be an unsigned integer.");
+    // ids for a million nodes are drawn here, so size the set up front rather
+    // than rehashing it twenty times on the way
     std::unordered_set<K> num_set;
+    num_set.reserve(x);
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_int_distribution<K> dist(0, max);
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <sched.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// CPU placement for the scheduler's workers.
+//
+// The runtime has no hook into the start of its worker threads, which inherit the
+// CPUs they may run on from the harness thread that starts them. So the harness
+// restricts itself to exactly `cores` CPUs for the length of a benchmark: the
+// workers share that set, and the kernel places them within it and may move them
+// around inside it, but they never run anywhere else. This is confinement to a
+// set of CPUs, not one worker pinned per CPU. Which CPUs make up the set is decided
+// from the topology in /sys/devices/system/cpu: every physical core is used before
+// any SMT sibling is, unless siblings are asked for on purpose.
+//
+// Once the benchmark is done the harness thread goes back to the CPUs the process
+// started with, and helper threads (the timer wheel, load generators) call unpin()
+// when they start, so they are not squeezed onto the workers' CPUs.
+namespace affinity {
+
+struct Cpu {
+  int id;
+  int package = 0;
+  int core = 0;
+  // 0 for the first hardware thread of a core, 1 for its sibling, and so on.
+  int smt = 0;
+};
+
+inline int read_int(const std::string& path, int otherwise) {
+  std::ifstream in(path);
+  int value;
+  return (in >> value) ? value : otherwise;
+}
+
+// "0-3,8,10-11" to {0, 1, 2, 3, 8, 10, 11}.
+inline std::vector<int> parse_list(const std::string& list) {
+  std::vector<int> cpus;
+  std::stringstream ranges(list);
+  std::string range;
+  while (std::getline(ranges, range, ',')) {
+    if (range.empty())
+      continue;
+    size_t dash = range.find('-');
+    int from = std::stoi(range.substr(0, dash));
+    int to = dash == std::string::npos ? from : std::stoi(range.substr(dash + 1));
+    for (int cpu = from; cpu <= to; cpu++)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+inline std::string format_list(const std::vector<int>& cpus) {
+  std::string list;
+  for (int cpu: cpus)
+    list += (list.empty() ? "" : ",") + std::to_string(cpu);
+  return list;
+}
+
+// The CPUs this process may run on, with their package, core and SMT rank. Where
+// /sys is not readable every CPU is taken to be a core of its own.
+inline std::vector<Cpu> topology() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+
+  std::vector<Cpu> cpus;
+  for (int id = 0; id < CPU_SETSIZE; id++) {
+    if (!CPU_ISSET(id, &allowed))
+      continue;
+    std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(id) + "/topology/";
+    Cpu cpu{id};
+    cpu.package = read_int(dir + "physical_package_id", 0);
+    cpu.core = read_int(dir + "core_id", id);
+    std::ifstream siblings(dir + "thread_siblings_list");
+    std::string list;
+    if (siblings >> list) {
+      std::vector<int> ids = parse_list(list);
+      cpu.smt = (int)(std::find(ids.begin(), ids.end(), id) - ids.begin());
+    }
+    cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+// The order in which CPUs are handed to workers under `policy`:
+//  - compact fills the physical cores of one package before moving to the next,
+//  - scatter deals physical cores round robin over the packages,
+//  - siblings fills both hardware threads of a core before the next core, to
+//    measure what sharing a core costs,
+//  - anything else is an explicit list such as "0,2,4-7", used as given.
+// Apart from siblings, second hardware threads only come after every core has one.
+inline std::vector<int> order(const std::string& policy) {
+  if (policy != "compact" && policy != "scatter" && policy != "siblings")
+    return parse_list(policy);
+
+  std::vector<Cpu> cpus = topology();
+  // rank of each core within its package, for scatter
+  std::vector<std::tuple<int, int, int>> cores;
+  for (const Cpu& cpu: cpus)
+    cores.emplace_back(cpu.package, cpu.core, 0);
+  std::sort(cores.begin(), cores.end());
+  cores.erase(std::unique(cores.begin(), cores.end()), cores.end());
+  auto rank = [&](const Cpu& cpu) {
+    int r = 0;
+    for (auto& [package, core, _]: cores) {
+      if (package == cpu.package && core == cpu.core)
+        return r;
+      if (package == cpu.package)
+        r++;
+    }
+    return r;
+  };
+
+  auto key = [&](const Cpu& cpu) {
+    if (policy == "compact")
+      return std::make_tuple(cpu.smt, cpu.package, cpu.core, cpu.id);
+    if (policy == "scatter")
+      return std::make_tuple(cpu.smt, rank(cpu), cpu.package, cpu.id);
+    return std::make_tuple(cpu.package, cpu.core, cpu.smt, cpu.id);
+  };
+  std::sort(cpus.begin(), cpus.end(), [&](const Cpu& a, const Cpu& b) { return key(a) < key(b); });
+
+  std::vector<int> ids;
+  for (const Cpu& cpu: cpus)
+    ids.push_back(cpu.id);
+  return ids;
+}
+
+// The CPUs the process was allowed when this was first called, which pin() makes
+// sure happens before it narrows anything.
+inline const cpu_set_t& original() {
+  static const cpu_set_t set = []() {
+    cpu_set_t s;
+    CPU_ZERO(&s);
+    if (sched_getaffinity(0, sizeof(s), &s) != 0) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        CPU_SET(cpu, &s);
+    }
+    return s;
+  }();
+  return set;
+}
+
+// Restricts the calling thread, and every thread it starts from now on, to the
+// first `count` CPUs of `cpus`. Returns the CPUs used.
+inline std::vector<int> pin(const std::vector<int>& cpus, size_t count) {
+  original();
+  if (cpus.empty())
+    throw std::invalid_argument("no CPUs to pin to");
+  std::vector<int> used(cpus.begin(), cpus.begin() + std::min(count, cpus.size()));
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu: used)
+    CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    throw std::runtime_error("could not pin to CPUs " + format_list(used));
+  return used;
+}
+
+// Lets the calling thread run on every CPU the process started with again.
+inline void unpin() {
+  sched_setaffinity(0, sizeof(cpu_set_t), &original());
+}
+
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Heap traffic attributed to behaviours.
+//
+// Every worker has a current tag, a string literal naming the behaviour it is
+// running, set for the length of a scope by ALLOC_TAG("...") at the top of the
+// behaviour body. In a USE_ALLOC_PROFILE build operator new (alloc_profile.cpp)
+// charges each allocation, count and bytes, to the tag of the thread making it.
+// Only allocations that go through operator new are seen: the runtime allocates
+// cowns and behaviours, closures included, straight from snmalloc, so scheduling
+// a behaviour costs its caller nothing here. What is charged is the heap memory
+// the behaviour's own code asks for, the nodes of an unordered_set copied into a
+// capture among it. Allocations outside any tagged scope are charged to
+// "untagged".
+//
+// The table is fixed-size and keyed by the literal's address, so recording never
+// allocates; tags beyond TAGS are charged to "overflow". In other builds ALLOC_TAG
+// compiles to nothing.
+namespace allocs {
+
+struct Entry {
+  std::atomic<const char*> tag{nullptr};
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> bytes{0};
+};
+
+static constexpr size_t TAGS = 256;
+
+inline Entry table[TAGS];
+
+inline thread_local const char* current = nullptr;
+
+inline Entry& entry(const char* tag) {
+  size_t start = (reinterpret_cast<uintptr_t>(tag) >> 3) % TAGS;
+  for (size_t probe = 0; probe < TAGS; probe++) {
+    Entry& e = table[(start + probe) % TAGS];
+    const char* seen = e.tag.load(std::memory_order_acquire);
+    if (seen == tag)
+      return e;
+    if (seen == nullptr && e.tag.compare_exchange_strong(seen, tag, std::memory_order_acq_rel))
+      return e;
+    if (seen == tag)
+      return e;
+  }
+  static Entry overflow;
+  overflow.tag = "overflow";
+  return overflow;
+}
+
+inline void record(size_t size) {
+  Entry& e = entry(current != nullptr ? current : "untagged");
+  e.count.fetch_add(1, std::memory_order_relaxed);
+  e.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+// Sets the current tag until the end of the scope, then puts the previous one back.
+struct Scope {
+  const char* previous;
+
+  Scope(const char* tag): previous(current) { current = tag; }
+
+  ~Scope() { current = previous; }
+};
+
+// Zeroes the counts but keeps the tags, which are string literals and stay valid.
+inline void reset() {
+  for (Entry& e: table) {
+    e.count.store(0, std::memory_order_relaxed);
+    e.bytes.store(0, std::memory_order_relaxed);
+  }
+}
+
+// (tag, allocations, bytes) for every tag that allocated since the last reset.
+inline std::vector<std::tuple<std::string, uint64_t, uint64_t>> snapshot() {
+  std::vector<std::tuple<std::string, uint64_t, uint64_t>> result;
+  for (Entry& e: table) {
+    const char* tag = e.tag.load(std::memory_order_acquire);
+    uint64_t count = e.count.load(std::memory_order_relaxed);
+    if (tag != nullptr && count > 0)
+      result.emplace_back(tag, count, e.bytes.load(std::memory_order_relaxed));
+  }
+  return result;
+}
+
+};
+
+#ifdef USE_ALLOC_PROFILE
+#define ALLOC_TAG_CONCAT2(a, b) a##b
+#define ALLOC_TAG_CONCAT(a, b) ALLOC_TAG_CONCAT2(a, b)
+#define ALLOC_TAG(tag) allocs::Scope ALLOC_TAG_CONCAT(alloc_tag_, __LINE__)(tag)
+#else
+#define ALLOC_TAG(tag) ((void)0)
+#endif
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cpp/when.h>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace event {
+
+using namespace verona::cpp;
+
+// A one-to-many notification. Any number of subscribers can await the bell, and
+// ringing it hands the value to all of them. The bell latches: once rung it keeps
+// the value, so a subscriber that turns up late is called straight away rather
+// than missing it, until reset() re-arms the bell.
+//
+// Subscribers are not called inside the bell's behaviour. They are fanned out
+// over a tree of behaviours holding no cowns, each running up to LEAF of them, so
+// many subscribers are woken in parallel and the bell is free again right away.
+template <typename T>
+struct Bell {
+  static constexpr size_t LEAF = 64;
+
+  using Callback = std::function<void(T)>;
+
+  std::vector<Callback> subscribers;
+  std::optional<T> value;
+
+  static void await(const cown_ptr<Bell<T>> & self, Callback callback) {
+    when (self) << [=](acquired_cown<Bell<T>> self) {
+      if (self->value)
+        fan_out(std::make_shared<std::vector<Callback>>(1, callback), *self->value);
+      else
+        self->subscribers.push_back(callback);
+    };
+  }
+
+  static void notify(const cown_ptr<Bell<T>> & self, T item) {
+    when (self) << [=](acquired_cown<Bell<T>> self) {
+      self->value = item;
+      if (self->subscribers.empty())
+        return;
+      auto subscribers = std::make_shared<std::vector<Callback>>();
+      subscribers->swap(self->subscribers);
+      fan_out(subscribers, item);
+    };
+  }
+
+  static void reset(const cown_ptr<Bell<T>> & self) {
+    when (self) << [](acquired_cown<Bell<T>> self) {
+      self->value.reset();
+    };
+  }
+
+private:
+  static void fan_out(std::shared_ptr<std::vector<Callback>> subscribers, T item) {
+    fan_out(subscribers, item, 0, subscribers->size());
+  }
+
+  // Halves the range until it is small enough to run in one behaviour.
+  static void fan_out(std::shared_ptr<std::vector<Callback>> subscribers, T item, size_t from, size_t to) {
+    when () << [=]() {
+      size_t lo = from, hi = to;
+      while (hi - lo > LEAF) {
+        size_t mid = lo + (hi - lo) / 2;
+        fan_out(subscribers, item, mid, hi);
+        hi = mid;
+      }
+      for (size_t i = lo; i < hi; i++)
+        (*subscribers)[i](item);
+    };
+  }
+};
+
+};
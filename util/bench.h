@@ -3,7 +3,14 @@
 #include <cpp/when.h>
 #include <debug/harness.h>
 #include <float.h>
+#include <map>
+#include <sstream>
+#include "affinity.h"
+#include "allocs.h"
+#include "environment.h"
 #include "stats.h"
+#include "sweep.h"
+#include "timer.h"
 
 using namespace verona::cpp;
 
@@ -13,6 +20,8 @@ template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
 struct AsyncBenchmark {
   virtual void run()=0;
   virtual std::string paradigm()=0;
+  // Extra per-run measurements (e.g. message counts) reported next to the time.
+  virtual std::vector<std::pair<std::string, double>> metrics() { return {}; }
   virtual ~AsyncBenchmark() {}
 };
 
@@ -29,33 +38,136 @@ struct ActorBenchmark: public AsyncBenchmarkBase {
   std::string paradigm() { return "actor"; }
 };
 
+// Writers get the whole sample set and report the same statistics for times and
+// metrics: the mean with a Student-t 95% interval, the median with a bootstrap
+// 95% interval, the 5th and 95th percentiles, and how many samples are outliers
+// by Tukey's fences and by MAD.
 struct Writer {
   virtual void writeHeader()=0;
-  virtual void writeEntry(std::string benchmark, double mean, double median, double error, double stddev)=0;
+  virtual void writeEntry(std::string benchmark, SampleStats& stats)=0;
+  virtual void writeMetric(std::string benchmark, std::string metric, SampleStats& stats)=0;
+  // Something about how the benchmark was run rather than a measurement of it.
+  virtual void writeInfo(std::string benchmark, std::string key, std::string value)=0;
   virtual ~Writer() {}
 };
 
 struct CSVWriter: public Writer {
   void writeHeader() override {
-    std::cout << "benchmark,mean,median,error" << std::endl;
+    std::cout << "benchmark,mean,median,error,stddev,ci_low,ci_high,median_low,median_high,p5,p95,mad,tukey_outliers,mad_outliers" << std::endl;
   }
 
-  void writeEntry(std::string benchmark, double mean, double median, double error, double stddev) override {
-    std::cout << benchmark << "," << mean << "," << median << "," << error << std::endl;
+  void writeEntry(std::string benchmark, SampleStats& stats) override {
+    writeRow(benchmark, stats);
+  }
+
+  void writeMetric(std::string benchmark, std::string metric, SampleStats& stats) override {
+    writeRow(benchmark + ":" + metric, stats);
+  }
+
+  // Info has no statistics to fill the columns with, so it goes out as comment
+  // lines, which CSV readers can be told to skip (pandas: comment='#').
+  void writeInfo(std::string benchmark, std::string key, std::string value) override {
+    std::cout << "# " << benchmark << ":" << key << "," << quote(value) << std::endl;
+  }
+
+  // A quoted field, with quotes doubled and line breaks flattened so the comment
+  // stays on one line.
+  static std::string quote(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c: text) {
+      if (c == '"')
+        quoted += '"';
+      quoted += (c == '\n' || c == '\r') ? ' ' : c;
+    }
+    return quoted + "\"";
+  }
+
+  void writeRow(std::string label, SampleStats& stats) {
+    SampleStats::Interval median = stats.median_interval();
+    std::cout << label << ","
+              << stats.mean() << "," << stats.median() << "," << stats.ref_err() << "," << stats.stddev() << ","
+              << stats.confidence_low() << "," << stats.confidence_high() << ","
+              << median.first << "," << median.second << ","
+              << stats.percentile(0.05) << "," << stats.percentile(0.95) << ","
+              << stats.mad() << "," << stats.tukey_outliers() << "," << stats.mad_outliers()
+              << std::endl;
   }
 
   ~CSVWriter() override {}
 };
 
+// One JSON object per line for every entry, metric and piece of information.
+struct JSONWriter: public Writer {
+  static std::string quote(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c: text) {
+      if (c == '"' || c == '\\')
+        quoted += '\\';
+      quoted += c;
+    }
+    return quoted + "\"";
+  }
+
+  void writeHeader() override { }
+
+  void writeEntry(std::string benchmark, SampleStats& stats) override {
+    writeObject("{\"benchmark\":" + quote(benchmark), stats);
+  }
+
+  void writeMetric(std::string benchmark, std::string metric, SampleStats& stats) override {
+    writeObject("{\"benchmark\":" + quote(benchmark) + ",\"metric\":" + quote(metric), stats);
+  }
+
+  void writeInfo(std::string benchmark, std::string key, std::string value) override {
+    std::cout << "{\"benchmark\":" << quote(benchmark) << ",\"key\":" << quote(key) << ",\"value\":" << quote(value) << "}" << std::endl;
+  }
+
+  void writeObject(std::string prefix, SampleStats& stats) {
+    SampleStats::Interval median = stats.median_interval();
+    std::cout << prefix
+              << ",\"mean\":" << stats.mean() << ",\"median\":" << stats.median()
+              << ",\"error\":" << stats.ref_err() << ",\"stddev\":" << stats.stddev()
+              << ",\"ci\":[" << stats.confidence_low() << "," << stats.confidence_high() << "]"
+              << ",\"median_ci\":[" << median.first << "," << median.second << "]"
+              << ",\"p5\":" << stats.percentile(0.05) << ",\"p95\":" << stats.percentile(0.95)
+              << ",\"mad\":" << stats.mad() << ",\"tukey_outliers\":" << stats.tukey_outliers()
+              << ",\"mad_outliers\":" << stats.mad_outliers() << ",\"n\":" << stats.size()
+              << "}" << std::endl;
+  }
+
+  ~JSONWriter() override {}
+};
+
 struct ConsoleWriter: public Writer {
   void writeHeader() override { }
 
-  void writeEntry(std::string benchmark, double mean, double median, double error, double stddev) override {
+  void writeEntry(std::string benchmark, SampleStats& stats) override {
+    SampleStats::Interval median = stats.median_interval();
+    std::cout << benchmark << "   "
+              << stats.mean() << " ms   "
+              << stats.median() << " ms   "
+              << "+/- " << stats.ref_err() << " %   "
+              << stats.stddev() << "   "
+              << "median [" << median.first << ", " << median.second << "]   "
+              << "p5-p95 [" << stats.percentile(0.05) << ", " << stats.percentile(0.95) << "]   "
+              << "outliers " << stats.tukey_outliers() << "/" << stats.mad_outliers()
+              << std::endl;
+  }
+
+  void writeMetric(std::string benchmark, std::string metric, SampleStats& stats) override {
+    SampleStats::Interval median = stats.median_interval();
     std::cout << benchmark << "   "
-              << mean << " ms   "
-              << median << " ms   "
-              << "+/- " << error << " %   "
-              << stddev
+              << metric << "   "
+              << stats.mean() << "   "
+              << stats.median() << "   "
+              << "[" << median.first << ", " << median.second << "]"
+              << std::endl;
+  }
+
+  void writeInfo(std::string benchmark, std::string key, std::string value) override {
+    std::cout << benchmark << "   "
+              << key << "   "
+              << value
               << std::endl;
   }
 
@@ -69,6 +181,8 @@ struct BenchmarkHarness {
   size_t repetitions = 1;
   bool detect_leaks;
   std::unique_ptr<Writer> writer;
+  // CPUs in the order workers are placed on them, empty unless --pin is given.
+  std::vector<int> pin_order;
 
   static uint64_t& get_seed() {
     static uint64_t seed = 123456;
@@ -91,7 +205,7 @@ struct BenchmarkHarness {
 #endif
 
 #ifndef USE_SCHED_STATS
-    if(!opt.has("--csv"))
+    if(!opt.has("--csv") && !opt.has("--json"))
     {
       std::cout << "BenchmarkHarness starting." << std::endl;
 
@@ -111,6 +225,14 @@ struct BenchmarkHarness {
 
     cores = opt.is<size_t>("--cores", 4);
 
+    // --pin compact|scatter|siblings|<cpu list>, see affinity.h. The order is taken
+    // before pinning anything, while every CPU is still allowed.
+    if (opt.has("--pin")) {
+      pin_order = affinity::order(opt.is("--pin", "compact"));
+      if (pin_order.size() < cores)
+        std::cout << "WARNING: --pin has " << pin_order.size() << " CPUs for " << cores << " cores, workers will share CPUs" << std::endl;
+    }
+
 #ifdef USE_SYSTEMATIC_TESTING
     repetitions = opt.is<size_t>("--seed_count", 1);
     if (opt.has("--reps"))
@@ -118,7 +240,24 @@ struct BenchmarkHarness {
       std::cout << "WARNING: --reps is ignored when using systematic testing" << std::endl;
     }
 
-    if (opt.has("--log-all") || (repetitions == 1))
+    // --jobs N sweeps the --seed_count seeds over N forked workers instead, see
+    // sweep.h. Only the processes that run a seed get past this point, each with
+    // one seed to run and its output going to --sweep_logs or nowhere.
+    bool sweeping = opt.has("--jobs");
+    if (sweeping)
+    {
+      sweep::Options options;
+      options.first = get_seed();
+      options.count = repetitions;
+      options.jobs = std::max<size_t>(opt.is<size_t>("--jobs", std::thread::hardware_concurrency()), 1);
+      options.stop_on_failure = opt.has("--stop_on_failure");
+      options.timeout_s = opt.is<size_t>("--seed_timeout", 0);
+      options.logs = opt.is("--sweep_logs", "");
+      get_seed() = sweep::run(options);
+      repetitions = 1;
+    }
+
+    if (opt.has("--log-all") || (repetitions == 1 && !sweeping))
       Logging::enable_logging();
 #else
     repetitions = opt.is<size_t>("--reps", 100);
@@ -126,8 +265,15 @@ struct BenchmarkHarness {
     {
       std::cout << "WARNING: --seed_count is ignored when not using systematic testing" << std::endl;
     }
+    if (opt.has("--jobs"))
+    {
+      std::cout << "WARNING: --jobs is ignored when not using systematic testing" << std::endl;
+    }
 #endif
 
+    timer::set_scale(std::stod(opt.is("--time-scale", "1")));
+    timer::set_virtual(opt.has("--virtual-clock"));
+
     // snmalloc is the default allocator, and libc has some things it doesn't
     // deallocate.
     detect_leaks = false;
@@ -137,52 +283,193 @@ struct BenchmarkHarness {
 #ifndef USE_SCHED_STATS
     if (!opt.has("--scale"))
     {
-      writer = opt.has("--csv") ? std::unique_ptr<Writer>{std::make_unique<CSVWriter>()} : std::make_unique<ConsoleWriter>();
+      if (opt.has("--json"))
+        writer = std::make_unique<JSONWriter>();
+      else if (opt.has("--csv"))
+        writer = std::make_unique<CSVWriter>();
+      else
+        writer = std::make_unique<ConsoleWriter>();
       writer->writeHeader();
     }
 #endif
+
+    check_environment();
+  }
+
+  // Benchmark hygiene, see environment.h, for the CPUs the workers will use.
+  // Warnings go to stderr so CSV and JSON output stays parseable; the state of
+  // the machine goes out with the results, as writeInfo lines. --strict-env refuses to run if there
+  // is anything to warn about, --no-env-check skips the check.
+  void check_environment() {
+    if (opt.has("--no-env-check"))
+      return;
+    std::vector<int> cpus(pin_order.begin(), pin_order.begin() + std::min(cores, pin_order.size()));
+    environment::Report report = environment::check(cpus);
+    for (auto& warning: report.warnings)
+      std::cerr << "WARNING: " << warning << std::endl;
+    if (writer) {
+      for (auto& [key, value]: report.facts)
+        writer->writeInfo("environment", key, value);
+      for (auto& warning: report.warnings)
+        writer->writeInfo("environment", "warning", warning);
+    }
+    if (opt.has("--strict-env") && !report.warnings.empty()) {
+      std::cerr << "Refusing to run in a noisy environment (--strict-env)" << std::endl;
+      std::exit(1);
+    }
   }
 
   template<typename T, typename...Args>
   void run(Args&&... args) {
     SampleStats samples;
+    std::map<std::string, SampleStats> metric_samples;
 
     T benchmark(std::forward<Args>(args)...);
 
+    std::vector<int> placement;
+
     size_t min_cores = opt.has("--scale") ? 1 : cores;
     for (size_t c = min_cores; c <= cores; c++) {
+      if (!pin_order.empty())
+        placement = affinity::pin(pin_order, c);
+
       for (size_t i = 0; i < repetitions; ++i) {
-        Scheduler& sched = Scheduler::get();
+        double duration = once(benchmark, c, metric_samples);
+        samples.add(duration);
 
-        sched.init(c);
+        if (opt.has("--scale"))
+          std::cout << benchmark.paradigm() << "," << c << "," << benchmark.name << ", " << duration
+                    << (placement.empty() ? "" : ", " + affinity::format_list(placement)) << std::endl;
+      }
+    }
+    if (!pin_order.empty())
+      affinity::unpin();
+    if (opt.has("--scale"))
+      return;
+    report(benchmark.name, samples, metric_samples, placement);
+  }
 
-        high_resolution_clock::time_point start = high_resolution_clock::now();
+  // Compares two benchmarks on the same workload, both built from `args`. Runs
+  // alternate between them, A B then B A, so drift over the session and any
+  // advantage of going first or second hit both alike, and the i-th runs of each
+  // form a pair. Besides both benchmarks' own results, the time and every metric
+  // they share are reported as ratios B / A under "B/A": the per-pair ratios, and
+  // a paired bootstrap 95% interval on the ratio of the means. Pairs are compared
+  // on one core count, so --scale is refused.
+  template<typename A, typename B, typename...Args>
+  void run_paired(Args&&... args) {
+    if (opt.has("--scale")) {
+      std::cerr << "Paired runs compare two benchmarks on one core count, --scale is not supported" << std::endl;
+      std::exit(1);
+    }
+    A a(args...);
+    B b(args...);
+    SampleStats a_samples, b_samples;
+    std::map<std::string, SampleStats> a_metrics, b_metrics;
+
+    std::vector<int> placement;
+    if (!pin_order.empty())
+      placement = affinity::pin(pin_order, cores);
+
+    for (size_t i = 0; i < repetitions; ++i) {
+      if (i % 2 == 0) {
+        a_samples.add(once(a, cores, a_metrics));
+        b_samples.add(once(b, cores, b_metrics));
+      } else {
+        b_samples.add(once(b, cores, b_metrics));
+        a_samples.add(once(a, cores, a_metrics));
+      }
+    }
+    if (!pin_order.empty())
+      affinity::unpin();
 
-        SchedulerStats::get_tag() = benchmark.name.c_str();
+    report(a.name, a_samples, a_metrics, placement);
+    report(b.name, b_samples, b_metrics, placement);
+#ifndef USE_SCHED_STATS
+    std::string pair = b.name + "/" + a.name;
+    auto ratios = [&](const std::string& what, SampleStats& numerator, SampleStats& denominator) {
+      SampleStats ratio;
+      for (size_t i = 0; i < std::min(numerator.size(), denominator.size()); i++)
+        ratio.add(numerator.samples[i] / denominator.samples[i]);
+      writer->writeMetric(pair, what, ratio);
+      SampleStats::Interval interval = SampleStats::ratio_interval(numerator, denominator, true);
+      std::ostringstream text;
+      text << numerator.mean() / denominator.mean() << " [" << interval.first << ", " << interval.second << "]";
+      writer->writeInfo(pair, what + "_ratio_of_means", text.str());
+    };
+    ratios("time", b_samples, a_samples);
+    for (auto& [metric, stats]: b_metrics)
+      if (a_metrics.count(metric))
+        ratios(metric, stats, a_metrics[metric]);
+#endif
+  }
 
-        benchmark.run();
+private:
+  // One run of `benchmark` on `c` cores: the time it took in ms, with its metrics
+  // added to `metric_samples`.
+  template<typename T>
+  double once(T& benchmark, size_t c, std::map<std::string, SampleStats>& metric_samples) {
+    Scheduler& sched = Scheduler::get();
 
-        sched.run();
+#ifdef USE_SYSTEMATIC_TESTING
+    Systematic::set_seed(get_seed());
+#endif
+    sched.init(c);
 
-        double duration = (double)(duration_cast<microseconds>((high_resolution_clock::now() - start)).count()) / 1000;
-        samples.add(duration);
+    high_resolution_clock::time_point start = high_resolution_clock::now();
 
-        if (opt.has("--scale"))
-          std::cout << benchmark.paradigm() << "," << c << "," << benchmark.name << ", " << duration << std::endl;
+    SchedulerStats::get_tag() = benchmark.name.c_str();
 
-        if (detect_leaks)
-          snmalloc::debug_check_empty<snmalloc::Alloc::Config>();
+#ifdef USE_ALLOC_PROFILE
+    allocs::reset();
+#endif
+
+    {
+      ALLOC_TAG("setup");
+      benchmark.run();
+    }
+
+    sched.run();
+
+    // In virtual time the next timers only fire once the runtime has run out of
+    // work, then the scheduler is started again to run what they scheduled.
+    while (timer::is_virtual() && timer::virtual_clock().pending()) {
+      sched.init(c);
+      timer::virtual_clock().advance();
+      sched.run();
+    }
+
+    double duration = (double)(duration_cast<microseconds>((high_resolution_clock::now() - start)).count()) / 1000;
+
+#ifdef USE_ALLOC_PROFILE
+    // Allocations per behaviour tag in this rep, see allocs.h.
+    for (auto& [tag, count, bytes]: allocs::snapshot()) {
+      metric_samples["allocs:" + tag].add((double)count);
+      metric_samples["alloc_bytes:" + tag].add((double)bytes);
+    }
+#endif
+
+    for (auto& [metric, value]: benchmark.metrics())
+      metric_samples[metric].add(value);
+
+    if (detect_leaks)
+      snmalloc::debug_check_empty<snmalloc::Alloc::Config>();
 
 #ifdef USE_SYSTEMATIC_TESTING
-        get_seed()++;
-        printf("Seed: %zu\n", get_seed());
+    get_seed()++;
+    printf("Seed: %zu\n", get_seed());
 #endif
-      }
-    }
-    if (opt.has("--scale"))
-      return;
-#ifndef USE_SCHED_STATS 
-    writer->writeEntry(benchmark.name, samples.mean(), samples.median(), samples.ref_err(), samples.stddev());
+
+    return duration;
+  }
+
+  void report(const std::string& name, SampleStats& samples, std::map<std::string, SampleStats>& metric_samples, const std::vector<int>& placement) {
+#ifndef USE_SCHED_STATS
+    writer->writeEntry(name, samples);
+    if (!placement.empty())
+      writer->writeInfo(name, "cpus", affinity::format_list(placement));
+    for (auto& [metric, stats]: metric_samples)
+      writer->writeMetric(name, metric, stats);
 #endif
   }
-};
\ No newline at end of file
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// A statistics counter that many workers can bump without bouncing a single
+// cache line between them. Each thread is given one of a fixed number of
+// padded slots and the total is only summed when somebody asks for it, so it
+// is cheap enough to count messages on the hot path of a benchmark.
+struct ShardedCounter {
+  static constexpr size_t SLOTS = 64;
+
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> value{0};
+  };
+
+  Slot slots[SLOTS];
+
+  static size_t slot_index() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local size_t index = next_slot.fetch_add(1, std::memory_order_relaxed) % SLOTS;
+    return index;
+  }
+
+  void add(uint64_t n = 1) {
+    slots[slot_index()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  uint64_t total() const {
+    uint64_t sum = 0;
+    for (const Slot& slot: slots)
+      sum += slot.value.load(std::memory_order_relaxed);
+    return sum;
+  }
+
+  void reset() {
+    for (Slot& slot: slots)
+      slot.value.store(0, std::memory_order_relaxed);
+  }
+};
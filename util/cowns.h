@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cpp/when.h>
+#include "join.h"
+#include "topology.h"
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Creation of n cowns of one type, in index order, on the calling thread.
+//
+// This is a convenience, not an allocator: the runtime allocates every cown on
+// its own and offers no arena, so where the cowns end up is snmalloc's choice. A
+// plain loop of make_cown lays them out the same way.
+//
+// `args(i)` returns the constructor arguments of the i-th cown as a tuple.
+template <typename T, typename F>
+std::vector<verona::cpp::cown_ptr<T>> make_cowns(size_t n, F && args) {
+  std::vector<verona::cpp::cown_ptr<T>> cowns;
+  cowns.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    cowns.emplace_back(std::apply([](auto&&... a) {
+      return verona::cpp::make_cown<T>(std::forward<decltype(a)>(a)...);
+    }, args(i)));
+  }
+  return cowns;
+}
+
+// n payloads in one contiguous array, each guarded by a thin cown that holds only a
+// pointer to its payload.
+//
+// make_cown allocates every payload inside its own cown, next to the runtime's
+// bookkeeping, wherever snmalloc puts it. A slab takes the payloads out of the
+// cowns: they are built in index order into one vector, so payload i + 1 follows
+// payload i in memory, and a payload type declared alignas(64) gets whole cache
+// lines. Payloads refer to each other by index rather than by cown_ptr, so the
+// slab holds the only references to its cowns, and the cowns none to the slab.
+//
+// A behaviour acquires `cowns[i]` and reaches payload i through it, so access is
+// ordered exactly as if the payload were in the cown. The slab must outlive every
+// behaviour on its cowns; it is meant to be owned by the benchmark and shared as a
+// plain pointer. `args(i)` returns the constructor arguments of the i-th payload
+// as a tuple.
+template <typename T>
+struct Slab {
+  struct Guard {
+    T* payload;
+
+    Guard(T* payload): payload(payload) {}
+
+    T* operator->() { return payload; }
+    T& operator*() { return *payload; }
+  };
+
+  std::vector<T> payloads;
+  std::vector<verona::cpp::cown_ptr<Guard>> cowns;
+
+  template <typename F>
+  Slab(size_t n, F && args) {
+    payloads.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+      std::apply([&](auto&&... a) {
+        payloads.emplace_back(std::forward<decltype(a)>(a)...);
+      }, args(i));
+    }
+    cowns = make_cowns<Guard>(n, [&](size_t i) { return std::make_tuple(&payloads[i]); });
+  }
+
+  size_t size() const { return payloads.size(); }
+};
+
+// The successor link of a ring node: its `next` member, or what its `link()`
+// returns, for nodes that keep the link somewhere else in their payload.
+template <typename T, typename = void>
+struct has_link: std::false_type {};
+
+template <typename T>
+struct has_link<T, std::void_t<decltype(std::declval<T&>().link())>>: std::true_type {};
+
+template <typename T>
+verona::cpp::cown_ptr<T>& ring_link(T& node) {
+  if constexpr (has_link<T>::value)
+    return node.link();
+  else
+    return node.next;
+}
+
+// Creates a ring of n cowns in one burst, linking every node to its successor
+// through its constructor while nobody else can see it yet. Nodes are built from
+// last to first so that the successor always exists; only the link from the last
+// node back to the first is made after publication, by a single behaviour, which
+// is ordered before anything the caller schedules on the ring afterwards.
+//
+// T needs a `next` member of type cown_ptr<T> (or a `link()` returning one), and
+// `args(i, next)` returns the constructor arguments of the i-th node as a tuple.
+template <typename T, typename F>
+std::vector<verona::cpp::cown_ptr<T>> make_ring(size_t n, F && args) {
+  using namespace verona::cpp;
+  std::vector<cown_ptr<T>> cowns(n);
+  for (size_t i = n; i-- > 0;) {
+    cown_ptr<T> next = (i + 1 < n) ? cowns[i + 1] : cown_ptr<T>();
+    cowns[i] = std::apply([](auto&&... a) {
+      return make_cown<T>(std::forward<decltype(a)>(a)...);
+    }, args(i, next));
+  }
+  when (cowns[n - 1]) << [first = cowns[0]](acquired_cown<T> last) {
+    ring_link(*last) = first;
+  };
+  return cowns;
+}
+
+// Hands every node the handles of its neighbours in `graph`, with one behaviour per
+// node instead of one two-cown behaviour per edge. Anything scheduled on the nodes
+// afterwards sees the complete neighbour lists.
+//
+// T needs a `neighbours` member of type std::vector<cown_ptr<T>>.
+template <typename T>
+void wire_graph(const topology::Graph & graph, const std::vector<verona::cpp::cown_ptr<T>> & nodes) {
+  using namespace verona::cpp;
+  for (uint64_t i = 0; i < graph.nodes(); i++) {
+    std::vector<cown_ptr<T>> neighbours;
+    neighbours.reserve(graph.degree(i));
+    for (const uint64_t* t = graph.begin(i); t != graph.end(i); t++)
+      neighbours.push_back(nodes[*t]);
+    when (nodes[i]) << [neighbours = std::move(neighbours)](acquired_cown<T> node) mutable {
+      node->neighbours = std::move(neighbours);
+    };
+  }
+}
+
+// Sharded setup, for graphs too big to build in one behaviour.
+//
+// make_cowns, make_ring and wire_graph run on whichever thread calls them, so at a
+// million nodes one worker does all of the setup while the rest sit idle. The
+// _sharded versions split the index range into `shards` contiguous slices, build
+// each slice in a behaviour of its own (with `when ()`, so they run in parallel),
+// and join them on a join::barrier that calls `then(cowns)` once all have finished.
+// Each slice is still allocated back to back on one thread, so neighbours in a
+// slice stay neighbours in memory. `args` is shared by every shard, not copied.
+namespace sharded {
+
+// The [begin, end) of shard s out of `shards` over n items.
+inline std::pair<size_t, size_t> slice(size_t n, size_t shards, size_t s) {
+  return {n * s / shards, n * (s + 1) / shards};
+}
+
+inline size_t clamp(size_t n, size_t shards) {
+  return std::max<size_t>(1, std::min(n, shards));
+}
+
+template <typename T>
+using Cowns = std::shared_ptr<std::vector<verona::cpp::cown_ptr<T>>>;
+
+};
+
+// make_cowns over `shards` parallel behaviours.
+template <typename T, typename F, typename Then>
+void make_cowns_sharded(size_t n, size_t shards, F args, Then then) {
+  using namespace verona::cpp;
+  shards = sharded::clamp(n, shards);
+  sharded::Cowns<T> cowns = std::make_shared<std::vector<cown_ptr<T>>>(n);
+  auto shared_args = std::make_shared<F>(std::move(args));
+  std::vector<join::Arrival> arrivals = join::barrier(shards, [cowns, then = std::move(then)]() mutable {
+    then(*cowns);
+  });
+  for (size_t s = 0; s < shards; s++) {
+    when () << [=]() {
+      auto [begin, end] = sharded::slice(n, shards, s);
+      for (size_t i = begin; i < end; i++) {
+        (*cowns)[i] = std::apply([](auto&&... a) {
+          return make_cown<T>(std::forward<decltype(a)>(a)...);
+        }, (*shared_args)(i));
+      }
+      arrivals[s]();
+    };
+  }
+}
+
+// make_ring over `shards` parallel behaviours. Each shard links its own slice
+// through the constructors, last to first, leaving its last node pointing nowhere;
+// once all have finished one behaviour per shard links that node to the first of
+// the next slice, before `then` runs, so anything `then` schedules on the ring is
+// ordered after the links.
+template <typename T, typename F, typename Then>
+void make_ring_sharded(size_t n, size_t shards, F args, Then then) {
+  using namespace verona::cpp;
+  shards = sharded::clamp(n, shards);
+  sharded::Cowns<T> cowns = std::make_shared<std::vector<cown_ptr<T>>>(n);
+  auto shared_args = std::make_shared<F>(std::move(args));
+  std::vector<join::Arrival> arrivals = join::barrier(shards, [cowns, n, shards, then = std::move(then)]() mutable {
+    for (size_t s = 0; s < shards; s++) {
+      size_t end = sharded::slice(n, shards, s).second;
+      when ((*cowns)[end - 1]) << [next = (*cowns)[end % n]](acquired_cown<T> last) {
+        ring_link(*last) = next;
+      };
+    }
+    then(*cowns);
+  });
+  for (size_t s = 0; s < shards; s++) {
+    when () << [=]() {
+      auto [begin, end] = sharded::slice(n, shards, s);
+      for (size_t i = end; i-- > begin;) {
+        cown_ptr<T> next = (i + 1 < end) ? (*cowns)[i + 1] : cown_ptr<T>();
+        (*cowns)[i] = std::apply([](auto&&... a) {
+          return make_cown<T>(std::forward<decltype(a)>(a)...);
+        }, (*shared_args)(i, next));
+      }
+      arrivals[s]();
+    };
+  }
+}
+
+// make_cowns and then wire_graph, both over `shards` parallel behaviours. Edges can
+// cross shards, so wiring starts only once every node exists, and `then` runs only
+// once every shard has scheduled its wiring behaviours, so that anything it
+// schedules on a node sees that node's complete neighbour list. `graph` must
+// outlive the setup.
+template <typename T, typename F, typename Then>
+void make_graph_sharded(const topology::Graph & graph, size_t shards, F args, Then then) {
+  using namespace verona::cpp;
+  const topology::Graph* g = &graph;
+  size_t n = graph.nodes();
+  shards = sharded::clamp(n, shards);
+  make_cowns_sharded<T>(n, shards, std::move(args), [g, n, shards, then = std::move(then)](std::vector<cown_ptr<T>> & built) mutable {
+    sharded::Cowns<T> nodes = std::make_shared<std::vector<cown_ptr<T>>>(std::move(built));
+    std::vector<join::Arrival> arrivals = join::barrier(shards, [nodes, then = std::move(then)]() mutable {
+      then(*nodes);
+    });
+    for (size_t s = 0; s < shards; s++) {
+      when () << [=]() {
+        auto [begin, end] = sharded::slice(n, shards, s);
+        for (uint64_t i = begin; i < end; i++) {
+          std::vector<cown_ptr<T>> neighbours;
+          neighbours.reserve(g->degree(i));
+          for (const uint64_t* t = g->begin(i); t != g->end(i); t++)
+            neighbours.push_back((*nodes)[*t]);
+          when ((*nodes)[i]) << [neighbours = std::move(neighbours)](acquired_cown<T> node) mutable {
+            node->neighbours = std::move(neighbours);
+          };
+        }
+        arrivals[s]();
+      };
+    }
+  });
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <sched.h>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// What the machine is doing besides the benchmark. Read once when the harness
+// starts, from /proc and /sys, in the spirit of pyperf's `system check`: anything
+// that is known to make run times drift or spread out gets a warning, and all of
+// it goes out with the results so noisy numbers can be told apart afterwards.
+namespace environment {
+
+struct Report {
+  std::vector<std::pair<std::string, std::string>> facts;
+  std::vector<std::string> warnings;
+
+  void fact(std::string key, std::string value) { facts.emplace_back(std::move(key), std::move(value)); }
+
+  void warn(std::string warning) { warnings.push_back(std::move(warning)); }
+};
+
+inline std::string read_line(const std::string& path) {
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+inline std::string cpu_file(int cpu, const std::string& name) {
+  return read_line("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/" + name);
+}
+
+// The CPUs this process may run on.
+inline std::vector<int> allowed_cpus() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    if (CPU_ISSET(cpu, &allowed))
+      cpus.push_back(cpu);
+  return cpus;
+}
+
+// Frequency scaling on `cpus`: the governor, whether turbo is on, and how far the
+// current frequency is below the maximum.
+inline void frequency(Report& report, const std::vector<int>& cpus) {
+  std::set<std::string> governors;
+  double lowest = 0, max = 0;
+  for (int cpu: cpus) {
+    std::string governor = cpu_file(cpu, "scaling_governor");
+    if (!governor.empty())
+      governors.insert(governor);
+    std::string current = cpu_file(cpu, "scaling_cur_freq"), top = cpu_file(cpu, "cpuinfo_max_freq");
+    if (current.empty() || top.empty())
+      continue;
+    double ratio = std::stod(current) / std::stod(top);
+    if (lowest == 0 || ratio < lowest)
+      lowest = ratio;
+    max = std::max(max, std::stod(top) / 1000);
+  }
+
+  if (governors.empty()) {
+    report.fact("governor", "unknown");
+  } else {
+    std::string all;
+    for (auto& governor: governors)
+      all += (all.empty() ? "" : ",") + governor;
+    report.fact("governor", all);
+    if (governors.size() > 1 || *governors.begin() != "performance")
+      report.warn("CPU frequency governor is " + all + ", not performance");
+  }
+
+  if (lowest > 0) {
+    std::ostringstream ratio;
+    ratio << lowest;
+    report.fact("max_mhz", std::to_string((long)max));
+    report.fact("lowest_frequency_ratio", ratio.str());
+    if (lowest < 0.9)
+      report.warn("a CPU runs at " + std::to_string((int)(lowest * 100)) + "% of its maximum frequency");
+  }
+
+  // intel_pstate says whether turbo is off, acpi-cpufreq whether boost is on.
+  std::string no_turbo = read_line("/sys/devices/system/cpu/intel_pstate/no_turbo");
+  std::string boost = read_line("/sys/devices/system/cpu/cpufreq/boost");
+  if (!no_turbo.empty() || !boost.empty()) {
+    bool turbo = !no_turbo.empty() ? no_turbo == "0" : boost == "1";
+    report.fact("turbo", turbo ? "on" : "off");
+    if (turbo)
+      report.warn("turbo boost is on, the frequency depends on temperature and how many cores are busy");
+  }
+}
+
+// The load average, and how many other threads are runnable right now. /proc/loadavg
+// reads "1m 5m 15m runnable/total last_pid", and counts the reader among the
+// runnable ones.
+inline void load(Report& report, size_t cpus) {
+  std::ifstream in("/proc/loadavg");
+  double one_minute, five_minutes, fifteen_minutes;
+  std::string runnable;
+  if (!(in >> one_minute >> five_minutes >> fifteen_minutes >> runnable) || runnable.find('/') == std::string::npos)
+    return;
+  long others = std::max(0L, std::stol(runnable.substr(0, runnable.find('/'))) - 1);
+  std::ostringstream load;
+  load << one_minute;
+  report.fact("load_1m", load.str());
+  report.fact("other_runnable", std::to_string(others));
+  if (one_minute > 0.1 * (double)cpus + 1)
+    report.warn("load average is " + load.str() + " on " + std::to_string(cpus) + " CPUs");
+  if (others > 0)
+    report.warn(std::to_string(others) + " other threads are runnable");
+}
+
+inline void memory(Report& report) {
+  // "always [madvise] never": the mode in use is the one in brackets.
+  std::string thp = read_line("/sys/kernel/mm/transparent_hugepage/enabled");
+  size_t open = thp.find('['), close = thp.find(']');
+  if (open != std::string::npos && close != std::string::npos) {
+    thp = thp.substr(open + 1, close - open - 1);
+    report.fact("transparent_hugepages", thp);
+    if (thp == "always")
+      report.warn("transparent huge pages are always on, page faults and khugepaged add noise");
+  }
+
+  // Only reported: ASLR moves code and data between processes, not between the
+  // reps of one, and is on almost everywhere (setarch -R turns it off).
+  std::string aslr = read_line("/proc/sys/kernel/randomize_va_space");
+  if (!aslr.empty())
+    report.fact("aslr", aslr);
+}
+
+// Everything above, for the CPUs the benchmark will run on.
+inline Report check(std::vector<int> cpus) {
+  if (cpus.empty())
+    cpus = allowed_cpus();
+  Report report;
+  frequency(report, cpus);
+  load(report, cpus.size());
+  memory(report);
+  return report;
+}
+
+};
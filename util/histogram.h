@@ -0,0 +1,202 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A high dynamic range histogram of non-negative integer values (nanoseconds,
+// usually) in fixed memory. Values below 2^PRECISION are counted exactly; above
+// that every power of two is split into 2^(PRECISION-1) linear sub-buckets, so
+// any value is reported to within 1 / 2^(PRECISION-1) of itself, whatever its
+// magnitude. Counts are atomic, so any number of threads can record at once.
+struct Histogram {
+  static constexpr unsigned PRECISION = 8;
+  static constexpr uint64_t SUB = uint64_t(1) << PRECISION;
+  static constexpr uint64_t HALF = SUB / 2;
+  static constexpr size_t BUCKETS = SUB + (64 - PRECISION) * HALF;
+
+  std::atomic<uint64_t> counts[BUCKETS];
+  std::atomic<uint64_t> total{0};
+  std::atomic<uint64_t> minimum{std::numeric_limits<uint64_t>::max()};
+  std::atomic<uint64_t> maximum{0};
+  std::atomic<uint64_t> sum{0};
+
+  Histogram() { reset(); }
+
+  static size_t index(uint64_t value) {
+    if (value < SUB)
+      return (size_t)value;
+    unsigned shift = (63 - (unsigned)__builtin_clzll(value)) - (PRECISION - 1);
+    return (size_t)(SUB + (shift - 1) * HALF + ((value >> shift) - HALF));
+  }
+
+  // The largest value that lands in the same bucket as index `i`.
+  static uint64_t highest(size_t i) {
+    if (i < SUB)
+      return i;
+    uint64_t shift = (i - SUB) / HALF + 1;
+    uint64_t sub = (i - SUB) % HALF + HALF;
+    return ((sub + 1) << shift) - 1;
+  }
+
+  void record(uint64_t value, uint64_t n = 1) {
+    counts[index(value)].fetch_add(n, std::memory_order_relaxed);
+    total.fetch_add(n, std::memory_order_relaxed);
+    sum.fetch_add(value * n, std::memory_order_relaxed);
+    uint64_t seen = minimum.load(std::memory_order_relaxed);
+    while (value < seen && !minimum.compare_exchange_weak(seen, value, std::memory_order_relaxed));
+    seen = maximum.load(std::memory_order_relaxed);
+    while (value > seen && !maximum.compare_exchange_weak(seen, value, std::memory_order_relaxed));
+  }
+
+  // Adds everything recorded in `other`, which must not be recording at the time.
+  void merge(const Histogram& other) {
+    for (size_t i = 0; i < BUCKETS; i++) {
+      uint64_t n = other.counts[i].load(std::memory_order_relaxed);
+      if (n > 0)
+        counts[i].fetch_add(n, std::memory_order_relaxed);
+    }
+    total += other.total.load();
+    sum += other.sum.load();
+    uint64_t low = other.minimum.load(), high = other.maximum.load();
+    uint64_t seen = minimum.load();
+    while (low < seen && !minimum.compare_exchange_weak(seen, low));
+    seen = maximum.load();
+    while (high > seen && !maximum.compare_exchange_weak(seen, high));
+  }
+
+  void reset() {
+    for (auto& count: counts)
+      count.store(0, std::memory_order_relaxed);
+    total = 0;
+    sum = 0;
+    minimum = std::numeric_limits<uint64_t>::max();
+    maximum = 0;
+  }
+
+  uint64_t count() const { return total.load(); }
+
+  uint64_t min() const { return count() == 0 ? 0 : minimum.load(); }
+
+  uint64_t max() const { return maximum.load(); }
+
+  double mean() const { return count() == 0 ? 0 : (double)sum.load() / (double)count(); }
+
+  // The value below which a fraction `q` of the recorded values fall, reported
+  // as the top of its bucket and never above the largest value seen.
+  uint64_t quantile(double q) const {
+    uint64_t n = count();
+    if (n == 0)
+      return 0;
+    uint64_t rank = (uint64_t)(q * (double)n);
+    if (rank >= n)
+      rank = n - 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+      seen += counts[i].load(std::memory_order_relaxed);
+      if (seen > rank)
+        return std::min(highest(i), max());
+    }
+    return max();
+  }
+};
+
+// A Histogram per worker thread, merged only when read, so events can be timed
+// on the hot path of every worker without them sharing cache lines. Threads are
+// spread over SLOTS shards as in ShardedCounter, and a shard's histogram is only
+// allocated once a thread records into it, so memory is bounded by the number of
+// threads, not the number of events: at most SLOTS * sizeof(Histogram), about
+// 60 KB per recording thread. Quantiles stay within 1 / 2^(PRECISION-1) of the
+// true value however many events are recorded.
+struct ShardedHistogram {
+  static constexpr size_t SLOTS = 64;
+
+  struct alignas(64) Slot {
+    std::atomic<Histogram*> histogram{nullptr};
+  };
+
+  Slot slots[SLOTS];
+
+  ShardedHistogram() = default;
+  ShardedHistogram(const ShardedHistogram&) = delete;
+  ShardedHistogram& operator=(const ShardedHistogram&) = delete;
+
+  ~ShardedHistogram() {
+    for (Slot& slot: slots)
+      delete slot.histogram.load();
+  }
+
+  static size_t slot_index() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local size_t index = next_slot.fetch_add(1, std::memory_order_relaxed) % SLOTS;
+    return index;
+  }
+
+  Histogram& local() {
+    Slot& slot = slots[slot_index()];
+    Histogram* histogram = slot.histogram.load(std::memory_order_acquire);
+    if (histogram != nullptr)
+      return *histogram;
+    // Two threads can share a slot, so the first one to publish its histogram wins.
+    Histogram* fresh = new Histogram();
+    if (slot.histogram.compare_exchange_strong(histogram, fresh, std::memory_order_acq_rel))
+      return *fresh;
+    delete fresh;
+    return *histogram;
+  }
+
+  void record(uint64_t value, uint64_t n = 1) { local().record(value, n); }
+
+  // Merges every shard into `into`; recording should have stopped.
+  void merge_into(Histogram& into) const {
+    for (const Slot& slot: slots)
+      if (Histogram* histogram = slot.histogram.load(std::memory_order_acquire))
+        into.merge(*histogram);
+  }
+
+  std::unique_ptr<Histogram> merged() const {
+    auto histogram = std::make_unique<Histogram>();
+    merge_into(*histogram);
+    return histogram;
+  }
+
+  void reset() {
+    for (Slot& slot: slots)
+      if (Histogram* histogram = slot.histogram.load(std::memory_order_acquire))
+        histogram->reset();
+  }
+
+  // Count, mean, p50, p90, p99, p99.9 and max as benchmark metrics named
+  // `prefix` + statistic, in recorded units divided by `unit` (1e3 turns
+  // nanoseconds into microseconds).
+  std::vector<std::pair<std::string, double>> metrics(const std::string& prefix, double unit = 1) const {
+    std::unique_ptr<Histogram> all = merged();
+    return {
+      {prefix + "count", (double)all->count()},
+      {prefix + "mean", all->mean() / unit},
+      {prefix + "p50", all->quantile(0.5) / unit},
+      {prefix + "p90", all->quantile(0.9) / unit},
+      {prefix + "p99", all->quantile(0.99) / unit},
+      {prefix + "p999", all->quantile(0.999) / unit},
+      {prefix + "max", all->max() / unit}
+    };
+  }
+};
+
+// Times one event into a ShardedHistogram in nanoseconds: start a Stopwatch where
+// the event begins and stop it, in whichever behaviour, where it ends.
+struct Stopwatch {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  uint64_t elapsed_ns() const {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  void stop(ShardedHistogram& into) const { into.record(elapsed_ns()); }
+};
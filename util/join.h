@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cpp/when.h>
+#include <functional>
+#include <variant>
+#include <vector>
+#include "counter.h"
+
+// Joining over a collection of cowns only known at runtime.
+//
+// `when` takes a fixed list of cowns, and a vector of cowns of different types
+// (held as variants, since cown_ptr has no common base) cannot be spread into
+// one. when_all instead runs one behaviour on each cown and joins them on a
+// countdown barrier, so the continuation runs once every cown has been seen,
+// and a cown can hold back its arrival until it is in the state asked for.
+namespace join {
+
+using namespace verona::cpp;
+
+// Behaviours scheduled by this header, so benchmarks can report what a join costs.
+inline ShardedCounter behaviours;
+
+// Runs `then` once `remaining` arrivals have happened.
+struct Barrier {
+  size_t remaining;
+  std::function<void()> then;
+
+  Barrier(size_t remaining, std::function<void()> then): remaining(remaining), then(std::move(then)) {}
+};
+
+// One arrival at a barrier. It may be called from any behaviour, at any later
+// time, but only once.
+struct Arrival {
+  cown_ptr<Barrier> barrier;
+
+  void operator()() const {
+    behaviours.add();
+    when (barrier) << [](acquired_cown<Barrier> barrier) {
+      if (--barrier->remaining == 0)
+        barrier->then();
+    };
+  }
+};
+
+// A barrier for `count` arrivals. With no arrivals to wait for, `then` runs now.
+template <typename F>
+std::vector<Arrival> barrier(size_t count, F then) {
+  if (count == 0) {
+    then();
+    return {};
+  }
+  cown_ptr<Barrier> b = make_cown<Barrier>(count, std::function<void()>(std::move(then)));
+  return std::vector<Arrival>(count, Arrival{b});
+}
+
+template <typename C>
+struct cown_type;
+
+template <typename T>
+struct cown_type<cown_ptr<T>> {
+  using type = T;
+};
+
+// Runs `each(acquired, arrive)` in a behaviour on every cown in `cowns`, and
+// `done()` once every one of them has called its `arrive`, which it can do
+// straight away or later on.
+template <typename... Ts, typename F, typename Done>
+void when_all(const std::vector<std::variant<cown_ptr<Ts>...>>& cowns, F each, Done done) {
+  std::vector<Arrival> arrivals = barrier(cowns.size(), std::move(done));
+  for (size_t i = 0; i < cowns.size(); i++) {
+    std::visit([&](auto& cown) {
+      using T = typename cown_type<std::decay_t<decltype(cown)>>::type;
+      behaviours.add();
+      when (cown) << [each, arrive = arrivals[i]](acquired_cown<T> acquired) mutable {
+        each(acquired, arrive);
+      };
+    }, cowns[i]);
+  }
+}
+
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "counter.h"
+
+// A countdown latch that many workers can arrive at without queueing on one cown
+// or bouncing one cache line between them.
+//
+// The count is split into quotas over up to ShardedCounter::SLOTS padded leaves,
+// and a worker takes its arrivals from the leaf of its own slot, so until that
+// leaf runs dry nobody else writes its line. Once it is dry the worker takes from
+// the first leaf with quota left. A leaf reaching zero counts as one arrival at
+// its parent, in a combining tree of fan-in FANIN, and the arrival that empties
+// the root runs `then`. Every unit of the count is taken exactly once, so `then`
+// runs exactly once, after every arrival and able to see what each wrote before
+// arriving.
+//
+// `then` runs on the worker of the last arrival, from inside whatever behaviour
+// arrived, so it should schedule its work rather than do it. Arrivals beyond the
+// count are ignored. The latch must outlive the arrivals; it is meant to be owned
+// by the benchmark and shared as a plain pointer, since a refcount would be one
+// more line that every worker writes.
+struct Latch {
+  static constexpr size_t FANIN = 8;
+
+  struct alignas(64) Cell {
+    std::atomic<uint64_t> remaining{0};
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  // where each level of the tree starts in `cells`, and how wide it is, leaves first
+  std::vector<size_t> offsets;
+  std::vector<size_t> widths;
+  // leaves before this one have run dry
+  Cell cursor;
+  std::function<void()> then;
+
+  // A latch for `count` arrivals. With no arrivals to wait for, `then` runs now.
+  Latch(uint64_t count, std::function<void()> then): then(std::move(then)) {
+    size_t leaves = (size_t)std::max<uint64_t>(1, std::min<uint64_t>(count, ShardedCounter::SLOTS));
+    size_t total = 0;
+    for (size_t width = leaves;; width = (width + FANIN - 1) / FANIN) {
+      offsets.push_back(total);
+      widths.push_back(width);
+      total += width;
+      if (width == 1)
+        break;
+    }
+    cells = std::make_unique<Cell[]>(total);
+    for (size_t i = 0; i < leaves; i++)
+      cells[i].remaining.store(count / leaves + (i < count % leaves), std::memory_order_relaxed);
+    for (size_t level = 1; level < widths.size(); level++) {
+      for (size_t i = 0; i < widths[level]; i++)
+        cell(level, i).remaining.store(std::min(FANIN, widths[level - 1] - i * FANIN), std::memory_order_relaxed);
+    }
+    if (count == 0)
+      this->then();
+  }
+
+  void arrive() {
+    size_t leaves = widths[0];
+    if (take(ShardedCounter::slot_index() % leaves))
+      return;
+    // Our leaf is dry: take from the first one that is not. Leaves only ever run
+    // dry, so the ones before the cursor stay dry and nobody probes them twice.
+    for (size_t leaf = cursor.remaining.load(std::memory_order_relaxed); leaf < leaves; leaf++) {
+      if (take(leaf))
+        return;
+      uint64_t expected = leaf;
+      cursor.remaining.compare_exchange_strong(expected, leaf + 1, std::memory_order_relaxed);
+    }
+  }
+
+  bool done() const {
+    return cells[offsets.back()].remaining.load(std::memory_order_acquire) == 0;
+  }
+
+private:
+  Cell& cell(size_t level, size_t i) { return cells[offsets[level] + i]; }
+
+  bool take(size_t leaf) {
+    std::atomic<uint64_t>& remaining = cells[leaf].remaining;
+    uint64_t seen = remaining.load(std::memory_order_relaxed);
+    while (seen > 0) {
+      if (remaining.compare_exchange_weak(seen, seen - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+        if (seen == 1)
+          emptied(leaf);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Carries the emptying of a leaf up the tree for as long as it empties parents.
+  void emptied(size_t leaf) {
+    size_t i = leaf;
+    for (size_t level = 1; level < widths.size(); level++) {
+      i /= FANIN;
+      if (cell(level, i).remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+    }
+    then();
+  }
+};
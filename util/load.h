@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cpp/when.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "affinity.h"
+#include "histogram.h"
+#include "random.h"
+
+// Open-loop load generation.
+//
+// A closed-loop benchmark only starts the next request once the last one is
+// done, so when the system stalls it also stops asking, and the stall shows up
+// in one sample instead of all those that should have been sent meanwhile
+// (coordinated omission). Here requests are issued on a schedule fixed before
+// the run, at a constant rate or as a Poisson process, by a thread of their own
+// that does not wait for anything, and latency is measured from when each
+// request was meant to start, not from when it actually got sent.
+namespace load {
+
+using Clock = std::chrono::steady_clock;
+
+struct Schedule {
+  // requests per second
+  double rate = 10000;
+  bool poisson = false;
+  size_t requests = 100000;
+  uint64_t seed = 0;
+
+  // Start offsets of every request from the beginning of the run.
+  std::vector<Clock::duration> offsets() const {
+    std::vector<Clock::duration> offsets;
+    offsets.reserve(requests);
+    XorOshiro128Plus rand(seed);
+    double at_s = 0;
+    for (size_t i = 0; i < requests; i++) {
+      offsets.push_back(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(at_s)));
+      at_s += poisson ? -std::log(1 - rand.real()) / rate : 1 / rate;
+    }
+    return offsets;
+  }
+};
+
+// Latencies of completed requests, from their intended start, in nanoseconds.
+struct Recorder {
+  ShardedHistogram latency;
+  std::atomic<uint64_t> completed{0};
+  std::atomic<int64_t> last_ns{0};
+  Clock::time_point origin;
+
+  void reset(Clock::time_point start) {
+    latency.reset();
+    completed = 0;
+    last_ns = 0;
+    origin = start;
+  }
+
+  void done(Clock::time_point intended) {
+    Clock::time_point now = Clock::now();
+    latency.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - intended).count());
+    int64_t at = std::chrono::duration_cast<std::chrono::nanoseconds>(now - origin).count();
+    int64_t seen = last_ns;
+    while (at > seen && !last_ns.compare_exchange_weak(seen, at));
+    completed++;
+  }
+
+  // Completions per second over the whole run. When requests are offered faster
+  // than they can be served this is the saturation throughput.
+  double throughput() const {
+    return last_ns > 0 ? (double)completed / ((double)last_ns / 1e9) : 0;
+  }
+};
+
+// Issues `issue(i, intended)` for every request at its scheduled time. The
+// runtime is kept alive as an external event source until the last request has
+// been issued; issuing should do no more than schedule the request's behaviours.
+class Generator {
+  std::thread thread;
+
+public:
+  ~Generator() { join(); }
+
+  template <typename Issue>
+  void start(Clock::time_point origin, std::vector<Clock::duration> offsets, Issue issue) {
+    join();
+    verona::rt::Scheduler::add_external_event_source();
+    thread = std::thread([origin, offsets = std::move(offsets), issue]() mutable {
+      affinity::unpin();
+      for (size_t i = 0; i < offsets.size(); i++) {
+        Clock::time_point intended = origin + offsets[i];
+        // Sleep most of the way, then spin, as sleeps overshoot by tens of microseconds.
+        if (intended - Clock::now() > std::chrono::microseconds(100))
+          std::this_thread::sleep_until(intended - std::chrono::microseconds(50));
+        while (Clock::now() < intended)
+          std::this_thread::yield();
+        issue(i, intended);
+      }
+      verona::rt::Scheduler::remove_external_event_source();
+    });
+  }
+
+  void join() {
+    if (thread.joinable())
+      thread.join();
+  }
+};
+
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// Hardware counters for the whole benchmark, through perf_event_open.
+//
+// Counters are opened on the harness thread with `inherit` set, so every thread
+// it starts afterwards, the scheduler's workers included, is counted too; a
+// worker's counts are folded into the totals when it exits, which it has by the
+// time metrics() is called. Enabling, disabling and resetting a counter reaches
+// the copies in those threads as well, so counting can be started from inside a
+// behaviour once setup is done. Resetting does not clear what exited threads
+// folded in, so every start() takes a baseline that read() subtracts. Only
+// user-space events are counted, which is all that perf_event_paranoid <= 2
+// allows. Where counters are not available at all (containers, virtual machines
+// without a PMU) they are simply not reported.
+namespace perf {
+
+struct Counter {
+  std::string name;
+  int fd = -1;
+  uint64_t base = 0;
+
+  Counter(std::string name, uint32_t type, uint64_t config): name(std::move(name)) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+
+  Counter(const Counter&) = delete;
+  Counter& operator=(const Counter&) = delete;
+
+  ~Counter() {
+    if (fd >= 0)
+      close(fd);
+  }
+
+  void start() {
+    if (fd < 0)
+      return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    base = 0;
+    raw(base);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  void stop() {
+    if (fd >= 0)
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+
+  // Counted since the last start().
+  bool read(uint64_t & value) const {
+    if (!raw(value))
+      return false;
+    value -= base;
+    return true;
+  }
+
+private:
+  bool raw(uint64_t & value) const {
+    return fd >= 0 && ::read(fd, &value, sizeof(value)) == (ssize_t)sizeof(value);
+  }
+};
+
+// L1 data cache read misses and last-level cache misses go up when workers keep
+// stealing lines from each other, which is what false sharing looks like from
+// outside; cycles and instructions put them in proportion.
+struct Counters {
+  static uint64_t cache(uint64_t cache, uint64_t op, uint64_t result) {
+    return cache | (op << 8) | (result << 16);
+  }
+
+  Counter cycles{"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES};
+  Counter instructions{"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS};
+  Counter cache_misses{"cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES};
+  Counter l1d_misses{"l1d_read_misses", PERF_TYPE_HW_CACHE,
+    cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)};
+
+  Counter* all[4] = {&cycles, &instructions, &cache_misses, &l1d_misses};
+
+  void start() {
+    for (Counter* counter: all)
+      counter->start();
+  }
+
+  void stop() {
+    for (Counter* counter: all)
+      counter->stop();
+  }
+
+  // Every counter that could be read, divided by `per` (e.g. the number of
+  // messages) and named `prefix` + counter.
+  std::vector<std::pair<std::string, double>> metrics(const std::string& prefix = "", double per = 1) const {
+    std::vector<std::pair<std::string, double>> result;
+    for (const Counter* counter: all) {
+      uint64_t value;
+      if (counter->read(value))
+        result.emplace_back(prefix + counter->name, (double)value / per);
+    }
+    return result;
+  }
+};
+
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cpp/when.h>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <vector>
+
+// Capacity-limited resources: a fixed number of units (spaces in a pan, toasters
+// in a kitchen) handed out first come, first served, with requests queueing
+// while none are free.
+namespace resource {
+
+using namespace verona::cpp;
+
+// Interchangeable units counted inside whichever cown owns them, and the
+// requests waiting for one. It is plain data, only touched from behaviours on
+// that cown.
+template <typename Request>
+struct Capacity {
+  size_t capacity;
+  size_t available;
+  std::deque<Request> waiting;
+
+  Capacity(size_t capacity): capacity(capacity), available(capacity) {}
+
+  // Takes a unit for `request` if one is free and returns true, otherwise
+  // queues the request behind those already waiting.
+  bool take(Request request) {
+    if (available > 0 && waiting.empty()) {
+      available--;
+      return true;
+    }
+    waiting.push_back(std::move(request));
+    return false;
+  }
+
+  // Hands a unit back. If a request was waiting, the unit passes straight to it
+  // and it is returned, otherwise the unit becomes free again.
+  std::optional<Request> give_back() {
+    if (!waiting.empty()) {
+      Request next = std::move(waiting.front());
+      waiting.pop_front();
+      return next;
+    }
+    available = std::min(capacity, available + 1);
+    return std::nullopt;
+  }
+};
+
+// Distinguishable units shared by many cowns, in a cown of their own. Whoever
+// acquires a unit is given which one, and must release that unit when done.
+template <typename Unit>
+struct Pool {
+  std::vector<Unit> free;
+  std::deque<std::function<void(Unit)>> waiting;
+
+  Pool(std::vector<Unit> units): free(std::move(units)) {}
+
+  // Calls `then(unit)` once a unit has been granted. It runs in a behaviour on
+  // the pool, so it should do no more than schedule the work that uses the unit.
+  template <typename F>
+  static void acquire(const cown_ptr<Pool> & self, F then) {
+    when (self) << [then = std::function<void(Unit)>(std::move(then))](acquired_cown<Pool> pool) mutable {
+      if (pool->free.empty()) {
+        pool->waiting.push_back(std::move(then));
+        return;
+      }
+      Unit unit = std::move(pool->free.back());
+      pool->free.pop_back();
+      then(std::move(unit));
+    };
+  }
+
+  static void release(const cown_ptr<Pool> & self, Unit unit) {
+    when (self) << [unit = std::move(unit)](acquired_cown<Pool> pool) mutable {
+      if (pool->waiting.empty()) {
+        pool->free.push_back(std::move(unit));
+        return;
+      }
+      auto next = std::move(pool->waiting.front());
+      pool->waiting.pop_front();
+      next(std::move(unit));
+    };
+  }
+};
+
+};
@@ -1,19 +1,34 @@
 #pragma once
 
-#include <set>
+#include <algorithm>
 #include <cmath>
-
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "random.h"
+
+// Summary statistics over the samples of a benchmark, usually one per rep.
+//
+// Runs are often only 5-10 reps long, so intervals on the mean use Student's t
+// rather than the normal approximation, and the median and ratios between
+// benchmarks get bootstrap intervals, which assume nothing about the shape of the
+// distribution. Samples are kept in the order they were added, so two
+// SampleStats filled in lockstep stay paired.
 struct SampleStats {
+  using Interval = std::pair<double, double>;
+
+  static constexpr size_t RESAMPLES = 2000;
+
   std::vector<double> samples;
-  bool sorted = true;
 
   SampleStats() {};
 
   void add(double sample) {
     samples.push_back(sample);
-    sorted = false;
   }
 
+  size_t size() const { return samples.size(); }
+
   double sum() {
     double total = 0;
     for (const double& sample: samples) {
@@ -23,28 +38,27 @@ struct SampleStats {
     return total;
   }
 
-  double mean() { return sum() / samples.size(); }
+  double mean() { return samples.empty() ? 0 : sum() / samples.size(); }
 
-  double median() {
-    if (std::exchange(sorted, true)) std::sort(samples.begin(), samples.end());
+  // The p-th quantile, p in [0, 1], interpolating linearly between the two
+  // closest ranks. Selects on a copy rather than sorting the samples.
+  double percentile(double p) { return percentile(samples, p); }
 
-    uint64_t size = samples.size();
-
-    if (size == 0) {
+  static double percentile(std::vector<double> values, double p) {
+    if (values.empty())
       return 0;
-    } else if (size == 1) {
-      return samples[0];
-    } else {
-      uint64_t middle = size / 2;
-
-      if (size % 2 == 1) {
-        return samples[middle];
-      } else {
-        return (samples[middle - 1] + samples[middle]) / 2.0;
-      }
-    }
+    double rank = std::clamp(p, 0.0, 1.0) * (double)(values.size() - 1);
+    size_t lo = (size_t)rank;
+    std::nth_element(values.begin(), values.begin() + lo, values.end());
+    double low = values[lo];
+    if (lo + 1 == values.size())
+      return low;
+    double high = *std::min_element(values.begin() + lo + 1, values.end());
+    return low + (high - low) * (rank - (double)lo);
   }
 
+  double median() { return percentile(0.5); }
+
   double geometric_mean() {
     double result = 0;
 
@@ -52,7 +66,7 @@ struct SampleStats {
       result += std::log10(sample);
     }
 
-    return std::pow(result / ((double)samples.size()), 10);
+    return std::pow(10.0, result / ((double)samples.size()));
   }
 
   double harmonic_mean() {
@@ -65,7 +79,11 @@ struct SampleStats {
     return ((double) samples.size()) / denom;
   }
 
+  // Sample standard deviation, with Bessel's correction.
   double stddev() {
+    if (samples.size() < 2)
+      return 0;
+
     double m = mean();
     double temp = 0;
 
@@ -73,16 +91,121 @@ struct SampleStats {
       temp += ((m - sample) * (m - sample));
     }
 
-    return std::sqrt(temp / ((double)samples.size()));
+    return std::sqrt(temp / ((double)samples.size() - 1));
   }
 
   double ref_err() { return 100.0 * ((confidence_high() - mean()) / mean()); }
 
   double variation() { return stddev() / mean(); }
 
-  double confidence_low() { return mean() - (1.96 * (stddev() / std::sqrt(samples.size()))); }
+  // Two-sided 95% critical value of Student's t with `df` degrees of freedom.
+  // Tabulated up to 30, beyond which the Cornish-Fisher expansion around the
+  // normal value is within 1e-4.
+  static double t_critical(size_t df) {
+    static constexpr double table[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (df == 0)
+      return 0;
+    if (df <= 30)
+      return table[df - 1];
+    double z = 1.959964, n = (double)df;
+    return z + (z * z * z + z) / (4 * n) + (5 * std::pow(z, 5) + 16 * z * z * z + 3 * z) / (96 * n * n);
+  }
+
+  double margin() {
+    if (samples.size() < 2)
+      return 0;
+    return t_critical(samples.size() - 1) * stddev() / std::sqrt((double)samples.size());
+  }
+
+  double confidence_low() { return mean() - margin(); }
+
+  double confidence_high() { return mean() + margin(); }
+
+  // Percentile bootstrap: the statistic is recomputed over RESAMPLES resamples
+  // drawn with replacement and the interval is the middle 95% of the results.
+  // The generator is seeded the same way every time, so the intervals are
+  // reproducible.
+  template <typename Statistic>
+  Interval bootstrap(Statistic statistic, size_t resamples = RESAMPLES) {
+    if (samples.size() < 2)
+      return {statistic(samples), statistic(samples)};
+    XorOshiro128Plus rand(samples.size());
+    std::vector<double> estimates, resample(samples.size());
+    estimates.reserve(resamples);
+    for (size_t r = 0; r < resamples; r++) {
+      for (double& value: resample)
+        value = samples[rand.integer(samples.size())];
+      estimates.push_back(statistic(resample));
+    }
+    return {percentile(estimates, 0.025), percentile(estimates, 0.975)};
+  }
+
+  Interval median_interval() {
+    return bootstrap([](const std::vector<double>& values) { return percentile(values, 0.5); });
+  }
+
+  // Bootstrap interval for mean(numerator) / mean(denominator). When the two were
+  // measured in pairs (interleaved runs, same number of samples) the pairs are
+  // resampled together, which cancels out drift that hits both sides alike;
+  // otherwise each side is resampled independently.
+  static Interval ratio_interval(const SampleStats& numerator, const SampleStats& denominator, bool paired, size_t resamples = RESAMPLES) {
+    const std::vector<double>& a = numerator.samples;
+    const std::vector<double>& b = denominator.samples;
+    if (a.empty() || b.empty())
+      return {0, 0};
+    paired = paired && a.size() == b.size();
+    XorOshiro128Plus rand(a.size() * 31 + b.size());
+    std::vector<double> estimates;
+    estimates.reserve(resamples);
+    for (size_t r = 0; r < resamples; r++) {
+      double top = 0, bottom = 0;
+      for (size_t i = 0; i < a.size(); i++) {
+        size_t j = rand.integer(a.size());
+        top += a[j];
+        if (paired)
+          bottom += b[j];
+      }
+      if (!paired)
+        for (size_t i = 0; i < b.size(); i++)
+          bottom += b[rand.integer(b.size())];
+      estimates.push_back((top / a.size()) / (bottom / b.size()));
+    }
+    return {percentile(estimates, 0.025), percentile(estimates, 0.975)};
+  }
+
+  // Median absolute deviation from the median.
+  double mad() {
+    double m = median();
+    std::vector<double> deviations;
+    deviations.reserve(samples.size());
+    for (const double& sample: samples)
+      deviations.push_back(std::abs(sample - m));
+    return percentile(deviations, 0.5);
+  }
+
+  // Samples outside Tukey's fences, [Q1 - k IQR, Q3 + k IQR].
+  size_t tukey_outliers(double k = 1.5) {
+    double q1 = percentile(0.25), q3 = percentile(0.75);
+    double low = q1 - k * (q3 - q1), high = q3 + k * (q3 - q1);
+    return (size_t)std::count_if(samples.begin(), samples.end(), [=](double sample) {
+      return sample < low || sample > high;
+    });
+  }
 
-  double confidence_high() { return mean() + (1.96 * (stddev() / std::sqrt(samples.size()))); }
+  // Samples whose modified z-score, 0.6745 (x - median) / MAD, is above
+  // `threshold` (Iglewicz and Hoaglin).
+  size_t mad_outliers(double threshold = 3.5) {
+    double m = median(), deviation = mad();
+    if (deviation == 0)
+      return 0;
+    return (size_t)std::count_if(samples.begin(), samples.end(), [=](double sample) {
+      return 0.6745 * std::abs(sample - m) / deviation > threshold;
+    });
+  }
 
   double skewness() {
     double m = mean();
@@ -90,7 +213,7 @@ struct SampleStats {
     double total = 0;
     double diff = 0;
 
-    if (samples.size() > 0) {
+    if (samples.size() > 1 && sd > 0) {
       for (const double& sample: samples) {
         diff = sample - m;
         total += (diff * diff * diff);
@@ -101,4 +224,4 @@ struct SampleStats {
       return 0;
     }
   }
-};
\ No newline at end of file
+};
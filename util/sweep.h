@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <signal.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Parallel seed sweeps for systematic testing.
+//
+// The driver forks `jobs` workers, which take seeds one at a time from a counter
+// shared with the driver, so a slow seed does not hold up a whole range. Every
+// seed runs in a process of its own, forked by the worker: a failing seed may
+// abort, crash or hang (up to `timeout_s`), and all the worker sees is how the
+// process ended. That process returns from run() with its seed and goes on to
+// run the benchmark, so the driver is started before anything else happens and
+// the runtime has no threads yet when it forks.
+namespace sweep {
+
+struct Options {
+  uint64_t first = 0;
+  uint64_t count = 1;
+  size_t jobs = 1;
+  bool stop_on_failure = false;
+  unsigned timeout_s = 0;
+  // where to keep the output of failing seeds, as seed-<n>.log; dropped if empty
+  std::string logs;
+};
+
+static constexpr size_t MAX_FAILURES = 4096;
+
+struct Shared {
+  std::atomic<uint64_t> next;
+  std::atomic<uint64_t> passed;
+  std::atomic<uint64_t> failed;
+  std::atomic<bool> stop;
+  uint64_t failures[MAX_FAILURES];
+  int statuses[MAX_FAILURES];
+};
+
+inline std::string describe(int status) {
+  if (WIFSIGNALED(status))
+    return WTERMSIG(status) == SIGALRM ? "timed out" : std::string("killed by ") + strsignal(WTERMSIG(status));
+  return "exited with " + std::to_string(WEXITSTATUS(status));
+}
+
+inline std::string log_path(const Options& options, uint64_t seed) {
+  return options.logs + "/seed-" + std::to_string(seed) + ".log";
+}
+
+// A worker: runs seeds until they run out. Returns a seed only in the process
+// forked to run it; the worker itself never returns.
+inline uint64_t work(const Options& options, Shared* shared) {
+  for (;;) {
+    uint64_t seed = shared->next.fetch_add(1);
+    if (seed >= options.first + options.count || shared->stop)
+      _exit(0);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+      int out = open(options.logs.empty() ? "/dev/null" : log_path(options, seed).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      dup2(out, STDOUT_FILENO);
+      dup2(out, STDERR_FILENO);
+      close(out);
+      if (options.timeout_s > 0)
+        alarm(options.timeout_s);
+      return seed;
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+      shared->passed++;
+      if (!options.logs.empty())
+        unlink(log_path(options, seed).c_str());
+      continue;
+    }
+    uint64_t index = shared->failed++;
+    if (index < MAX_FAILURES) {
+      shared->failures[index] = seed;
+      shared->statuses[index] = status;
+    }
+    if (options.stop_on_failure)
+      shared->stop = true;
+  }
+}
+
+// Fans the seeds out, waits for them and reports; exits with 1 if any seed failed.
+// Returns only in the processes that run a seed, with the seed to run.
+inline uint64_t run(const Options& options) {
+  Shared* shared = static_cast<Shared*>(mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+  if (shared == MAP_FAILED) {
+    perror("mmap");
+    exit(2);
+  }
+  new (shared) Shared();
+  shared->next = options.first;
+
+  std::cout << "Sweeping " << options.count << " seeds from " << options.first << " over " << options.jobs << " workers" << std::endl;
+  std::cout.flush();
+  auto begin = std::chrono::steady_clock::now();
+
+  std::vector<pid_t> workers;
+  for (size_t j = 0; j < options.jobs; j++) {
+    pid_t pid = fork();
+    if (pid == 0)
+      return work(options, shared);
+    workers.push_back(pid);
+  }
+  for (pid_t pid: workers)
+    waitpid(pid, nullptr, 0);
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  uint64_t passed = shared->passed, failed = shared->failed;
+  std::cout << "Seeds: " << passed << " passed, " << failed << " failed, "
+            << (double)(passed + failed) / seconds << " seeds/s" << std::endl;
+  for (uint64_t i = 0; i < std::min<uint64_t>(failed, MAX_FAILURES); i++) {
+    std::cout << "FAILED seed " << shared->failures[i] << " (" << describe(shared->statuses[i]) << ")";
+    if (!options.logs.empty())
+      std::cout << ", output in " << log_path(options, shared->failures[i]);
+    std::cout << std::endl;
+  }
+  if (failed > 0)
+    std::cout << "Rerun one with --seed <n> --seed_count 1 to replay it with logging." << std::endl;
+  exit(failed > 0 ? 1 : 0);
+}
+
+};
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <cpp/when.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "affinity.h"
+
+// Delays that do not occupy a worker.
+//
+// A behaviour that models something taking time used to usleep, which keeps a
+// scheduler thread blocked for the whole wait, so no more things can be "in
+// progress" than there are cores. Instead, timer::after hands a callback to a
+// hashed timer wheel running on its own thread, and the callback schedules the
+// behaviour that continues the work once the delay has passed.
+//
+// Delays can be scaled down with set_scale, or taken off the real clock
+// altogether with set_virtual, in which case the benchmark harness advances a
+// simulated clock whenever the runtime runs out of work.
+namespace timer {
+
+using Clock = std::chrono::steady_clock;
+
+// Callbacks are kept in the slot of the tick they are due on, modulo the number
+// of slots, and fired by the wheel's thread once that tick has passed. While any
+// callback is pending the wheel is registered as an external event source, so
+// the scheduler does not finish before the last one has fired.
+class Wheel {
+  static constexpr size_t SLOTS = 1024;
+
+  struct Entry {
+    uint64_t due;
+    std::function<void()> fn;
+  };
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::vector<Entry> slots[SLOTS];
+  size_t pending = 0;
+  uint64_t processed = 0;
+  Clock::time_point origin;
+  Clock::duration tick;
+  std::thread thread;
+  bool stopping = false;
+
+public:
+  Wheel(Clock::duration tick = std::chrono::milliseconds(1)): origin(Clock::now()), tick(tick) {}
+
+  ~Wheel() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable())
+      thread.join();
+  }
+
+  void schedule(Clock::duration delay, std::function<void()> fn) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t due = std::max(ticks_until(Clock::now() + delay), processed + 1);
+    slots[due % SLOTS].push_back({due, std::move(fn)});
+    if (pending++ == 0)
+      verona::rt::Scheduler::add_external_event_source();
+    if (!thread.joinable())
+      thread = std::thread([this]() {
+        affinity::unpin();
+        loop();
+      });
+    wake.notify_one();
+  }
+
+private:
+  // Rounded up, so a callback never fires early.
+  uint64_t ticks_until(Clock::time_point t) const {
+    return (uint64_t)((t - origin + tick - Clock::duration(1)) / tick);
+  }
+
+  void loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    std::vector<std::function<void()>> due;
+    while (!stopping) {
+      if (pending == 0) {
+        wake.wait(lock);
+        continue;
+      }
+      wake.wait_until(lock, origin + tick * (processed + 1));
+
+      uint64_t current = (uint64_t)((Clock::now() - origin) / tick);
+      if (current <= processed)
+        continue;
+      // After a long wait every slot only needs looking at once.
+      uint64_t from = std::max(processed + 1, current >= SLOTS ? current - SLOTS + 1 : 0);
+      for (uint64_t t = from; t <= current; t++) {
+        std::vector<Entry>& slot = slots[t % SLOTS];
+        size_t kept = 0;
+        for (Entry& entry: slot) {
+          if (entry.due <= current)
+            due.push_back(std::move(entry.fn));
+          else
+            slot[kept++] = std::move(entry);
+        }
+        slot.resize(kept);
+      }
+      processed = current;
+      if (due.empty())
+        continue;
+
+      size_t fired = due.size();
+      lock.unlock();
+      for (auto& fn: due)
+        fn();
+      due.clear();
+      lock.lock();
+      pending -= fired;
+      if (pending == 0)
+        verona::rt::Scheduler::remove_external_event_source();
+    }
+  }
+};
+
+inline Wheel& wheel() {
+  static Wheel wheel;
+  return wheel;
+}
+
+// A discrete-event clock. Callbacks are only queued, and advance() fires all of
+// those due at the earliest time and moves the clock there. The harness calls it
+// each time the scheduler goes quiescent, so every callback fires once everything
+// it could depend on has happened and simulated time costs no real time at all.
+class VirtualClock {
+  struct Entry {
+    Clock::duration due;
+    uint64_t order;
+    std::function<void()> fn;
+
+    bool operator>(const Entry& other) const {
+      return due != other.due ? due > other.due : order > other.order;
+    }
+  };
+
+  std::mutex mutex;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+  Clock::duration time{0};
+  uint64_t scheduled = 0;
+
+public:
+  void schedule(Clock::duration delay, std::function<void()> fn) {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push({time + delay, scheduled++, std::move(fn)});
+  }
+
+  bool pending() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !queue.empty();
+  }
+
+  // Must be called while the scheduler is not running.
+  bool advance() {
+    std::vector<std::function<void()>> due;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (queue.empty())
+        return false;
+      time = queue.top().due;
+      while (!queue.empty() && queue.top().due == time) {
+        due.push_back(std::move(const_cast<Entry&>(queue.top()).fn));
+        queue.pop();
+      }
+    }
+    for (auto& fn: due)
+      fn();
+    return true;
+  }
+
+  Clock::duration now() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return time;
+  }
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    time = Clock::duration(0);
+  }
+};
+
+inline VirtualClock& virtual_clock() {
+  static VirtualClock clock;
+  return clock;
+}
+
+struct Settings {
+  double scale = 1.0;
+  bool virtual_time = false;
+  Clock::time_point origin = Clock::now();
+};
+
+inline Settings& settings() {
+  static Settings settings;
+  return settings;
+}
+
+// Real delays are multiplied by `scale`, so 1e-3 turns seconds into milliseconds.
+inline void set_scale(double scale) {
+  settings().scale = scale;
+}
+
+inline void set_virtual(bool virtual_time) {
+  settings().virtual_time = virtual_time;
+}
+
+inline bool is_virtual() {
+  return settings().virtual_time;
+}
+
+// Starts measuring simulated time from now.
+inline void reset() {
+  settings().origin = Clock::now();
+  virtual_clock().reset();
+}
+
+// Simulated time since reset(): the virtual clock, or real time with the scale
+// taken back out.
+inline Clock::duration elapsed() {
+  if (is_virtual())
+    return virtual_clock().now();
+  return std::chrono::duration_cast<Clock::duration>((Clock::now() - settings().origin) / settings().scale);
+}
+
+// Runs `fn` on the timer thread once `delay` has passed, or in virtual time when
+// the clock reaches it. It should do no more than schedule behaviours.
+template <typename F>
+void after(Clock::duration delay, F fn) {
+  if (is_virtual())
+    virtual_clock().schedule(delay, std::function<void()>(std::move(fn)));
+  else
+    wheel().schedule(std::chrono::duration_cast<Clock::duration>(delay * settings().scale), std::function<void()>(std::move(fn)));
+}
+
+// Bookkeeping for a cown whose operations take time on the timer rather than on
+// a worker. The cown is not held while the operation is in progress, so any
+// operation that must not overlap it waits here, and the waiting operations run
+// in order inside the behaviour that finishes it.
+template <typename T>
+struct Busy {
+  bool active = false;
+  std::deque<std::function<void(verona::cpp::acquired_cown<T>&)>> waiting;
+};
+
+// Marks the cown as busy until idle() is called.
+template <typename T>
+void occupy(verona::cpp::acquired_cown<T>& self) {
+  self->busy.active = true;
+}
+
+// Runs waiting operations until one of them makes the cown busy again.
+template <typename T>
+void resume(verona::cpp::acquired_cown<T>& self) {
+  while (!self->busy.active && !self->busy.waiting.empty()) {
+    auto op = std::move(self->busy.waiting.front());
+    self->busy.waiting.pop_front();
+    op(self);
+  }
+}
+
+template <typename T>
+void idle(verona::cpp::acquired_cown<T>& self) {
+  self->busy.active = false;
+  resume(self);
+}
+
+// Runs `op` now if the cown is idle, or after the operations in progress and
+// those already waiting.
+template <typename T, typename F>
+void when_idle(verona::cpp::acquired_cown<T>& self, F op) {
+  if (self->busy.active || !self->busy.waiting.empty())
+    self->busy.waiting.emplace_back(std::move(op));
+  else
+    op(self);
+}
+
+// Keeps the cown busy for `delay`, then runs `then` on it in a new behaviour
+// and lets the waiting operations go, unless `then` has started something else.
+template <typename T, typename F>
+void busy_for(verona::cpp::acquired_cown<T>& self, Clock::duration delay, F then) {
+  occupy(self);
+  verona::cpp::cown_ptr<T> cown = self.cown();
+  after(delay, [cown, then]() mutable {
+    verona::cpp::when (cown) << [then](verona::cpp::acquired_cown<T> self) mutable {
+      self->busy.active = false;
+      then(self);
+      resume(self);
+    };
+  });
+}
+
+};
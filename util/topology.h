@@ -0,0 +1,415 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "random.h"
+
+// Graph generators for the election benchmarks. Every generator is seeded and
+// returns an undirected graph in compressed sparse row form, so any election that
+// works on arbitrary graphs can be run on any of these shapes.
+//
+// Generation is split into fixed-size chunks of nodes that are handed out to a pool
+// of threads. Each chunk draws from its own stream derived from the seed, and the
+// chunking does not depend on the number of threads, so a seed always produces the
+// same graph.
+namespace topology {
+
+struct Graph {
+  // neighbours of node i are targets[offsets[i] .. offsets[i + 1])
+  std::vector<uint64_t> offsets{0};
+  std::vector<uint64_t> targets;
+
+  uint64_t nodes() const { return offsets.size() - 1; }
+
+  // undirected edges, each counted once
+  uint64_t edges() const { return targets.size() / 2; }
+
+  uint64_t degree(uint64_t i) const { return offsets[i + 1] - offsets[i]; }
+
+  const uint64_t* begin(uint64_t i) const { return targets.data() + offsets[i]; }
+
+  const uint64_t* end(uint64_t i) const { return targets.data() + offsets[i + 1]; }
+};
+
+using Edge = std::pair<uint64_t, uint64_t>;
+using EdgeChunks = std::vector<std::vector<Edge>>;
+
+static constexpr uint64_t CHUNK = 4096;
+
+inline uint64_t splitmix64(uint64_t& x) {
+  uint64_t z = (x += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+// An independent generator for one chunk of one graph.
+inline Rand stream(uint64_t seed, uint64_t chunk) {
+  uint64_t state = seed ^ splitmix64(chunk);
+  uint64_t x = splitmix64(state);
+  uint64_t y = splitmix64(state);
+  return Rand(x, y);
+}
+
+// Calls f(i) for every i in [0, count) on a pool of threads.
+template <typename F>
+void parallel_for(uint64_t count, F && f) {
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = (unsigned)std::min<uint64_t>(threads, count);
+  std::atomic<uint64_t> next{0};
+  auto worker = [&]() {
+    for (uint64_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+      f(i);
+  };
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; t++)
+    pool.emplace_back(worker);
+  worker();
+  for (std::thread& t: pool)
+    t.join();
+}
+
+// Calls f(chunk, begin, end) for every chunk of [0, n).
+template <typename F>
+void parallel_chunks(uint64_t n, F && f) {
+  uint64_t chunks = (n + CHUNK - 1) / CHUNK;
+  parallel_for(chunks, [&](uint64_t c) {
+    f(c, c * CHUNK, std::min(n, (c + 1) * CHUNK));
+  });
+}
+
+// Collects the edges produced by f(rng, begin, end, out) for every chunk of nodes.
+template <typename F>
+EdgeChunks chunked_edges(uint64_t n, uint64_t seed, F && f) {
+  EdgeChunks chunks((n + CHUNK - 1) / CHUNK);
+  parallel_chunks(n, [&](uint64_t c, uint64_t begin, uint64_t end) {
+    Rand rng = stream(seed, c);
+    f(rng, begin, end, chunks[c]);
+  });
+  return chunks;
+}
+
+// Builds the CSR form of an undirected graph. Each edge is stored at both of its
+// endpoints and every neighbour list is sorted, so the result does not depend on
+// the order in which threads filled it.
+inline Graph from_edges(uint64_t n, const EdgeChunks & chunks) {
+  Graph graph;
+  std::vector<std::atomic<uint64_t>> cursor(n);
+  parallel_for(chunks.size(), [&](uint64_t c) {
+    for (const Edge& e: chunks[c]) {
+      cursor[e.first].fetch_add(1, std::memory_order_relaxed);
+      cursor[e.second].fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+
+  graph.offsets.resize(n + 1);
+  graph.offsets[0] = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    graph.offsets[i + 1] = graph.offsets[i] + cursor[i].load(std::memory_order_relaxed);
+    cursor[i].store(graph.offsets[i], std::memory_order_relaxed);
+  }
+
+  graph.targets.resize(graph.offsets[n]);
+  parallel_for(chunks.size(), [&](uint64_t c) {
+    for (const Edge& e: chunks[c]) {
+      graph.targets[cursor[e.first].fetch_add(1, std::memory_order_relaxed)] = e.second;
+      graph.targets[cursor[e.second].fetch_add(1, std::memory_order_relaxed)] = e.first;
+    }
+  });
+
+  parallel_chunks(n, [&](uint64_t, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++)
+      std::sort(graph.targets.begin() + graph.offsets[i], graph.targets.begin() + graph.offsets[i + 1]);
+  });
+  return graph;
+}
+
+// Adds one edge from the lowest node of every connected component but the first to
+// a random node below it, which belongs to an earlier component, so a sparse random
+// graph becomes connected with as few extra edges as there were extra components.
+// The elections only finish once every node has heard from every other.
+inline void connect(uint64_t n, EdgeChunks & chunks, uint64_t seed) {
+  std::vector<uint64_t> parent(n);
+  std::iota(parent.begin(), parent.end(), 0);
+  auto find = [&](uint64_t x) {
+    while (parent[x] != x)
+      x = parent[x] = parent[parent[x]];
+    return x;
+  };
+  // the root of a component is always its lowest node
+  for (const std::vector<Edge>& chunk: chunks) {
+    for (const Edge& e: chunk) {
+      uint64_t a = find(e.first), b = find(e.second);
+      if (a != b)
+        parent[std::max(a, b)] = std::min(a, b);
+    }
+  }
+  std::vector<Edge> bridges;
+  Rand rng = stream(seed, chunks.size());
+  for (uint64_t i = 1; i < n; i++) {
+    if (find(i) == i)
+      bridges.emplace_back(rng.integer(i), i);
+  }
+  chunks.push_back(std::move(bridges));
+}
+
+// Drops repeated neighbours from a graph built by from_edges, for generators that
+// can draw the same edge from both of its ends.
+inline Graph simplify(Graph graph) {
+  uint64_t n = graph.nodes();
+  std::vector<uint64_t> degree(n);
+  parallel_chunks(n, [&](uint64_t, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) {
+      auto first = graph.targets.begin() + graph.offsets[i];
+      degree[i] = std::unique(first, graph.targets.begin() + graph.offsets[i + 1]) - first;
+    }
+  });
+  Graph simple;
+  simple.offsets.resize(n + 1);
+  for (uint64_t i = 0; i < n; i++)
+    simple.offsets[i + 1] = simple.offsets[i] + degree[i];
+  simple.targets.resize(simple.offsets[n]);
+  parallel_chunks(n, [&](uint64_t, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++)
+      std::copy_n(graph.begin(i), degree[i], simple.targets.begin() + simple.offsets[i]);
+  });
+  return simple;
+}
+
+inline Graph ring(uint64_t n) {
+  return from_edges(n, chunked_edges(n, 0, [n](Rand&, uint64_t begin, uint64_t end, std::vector<Edge>& out) {
+    for (uint64_t i = begin; i < end; i++) {
+      if (i + 1 < n)
+        out.emplace_back(i, i + 1);
+      else if (n > 2)
+        out.emplace_back(i, 0);
+    }
+  }));
+}
+
+// Node i > 0 hangs off node (i - 1) / k, so the tree is complete and as shallow as possible.
+inline Graph kary_tree(uint64_t n, uint64_t k) {
+  if (k == 0)
+    throw std::invalid_argument("a k-ary tree needs k >= 1");
+  return from_edges(n, chunked_edges(n, 0, [k](Rand&, uint64_t begin, uint64_t end, std::vector<Edge>& out) {
+    for (uint64_t i = std::max<uint64_t>(begin, 1); i < end; i++)
+      out.emplace_back((i - 1) / k, i);
+  }));
+}
+
+// Every node gets between 1 and max_children children, handed out in breadth-first
+// order, the same shape leader_tree builds from divide_randomly.
+inline Graph random_tree(uint64_t n, uint64_t max_children, uint64_t seed) {
+  if (max_children == 0)
+    throw std::invalid_argument("a random tree needs at least one child per node");
+  std::vector<uint64_t> parent(n, 0);
+  Rand rng = stream(seed, 0);
+  uint64_t next = 1;
+  for (uint64_t i = 0; next < n; i++) {
+    uint64_t children = std::min(1 + rng.integer(max_children), n - next);
+    for (uint64_t c = 0; c < children; c++)
+      parent[next++] = i;
+  }
+  return from_edges(n, chunked_edges(n, seed, [&](Rand&, uint64_t begin, uint64_t end, std::vector<Edge>& out) {
+    for (uint64_t i = std::max<uint64_t>(begin, 1); i < end; i++)
+      out.emplace_back(parent[i], i);
+  }));
+}
+
+// G(n, p) with p chosen to give the requested average degree. Each node draws its
+// higher-numbered neighbours by geometric skipping, so the cost is O(n + edges).
+// Isolated nodes and other stray components are then bridged to the rest.
+inline Graph erdos_renyi(uint64_t n, double average_degree, uint64_t seed) {
+  double p = (n > 1) ? std::min(1.0, average_degree / (double)(n - 1)) : 0;
+  EdgeChunks chunks = chunked_edges(n, seed, [n, p](Rand& rng, uint64_t begin, uint64_t end, std::vector<Edge>& out) {
+    if (p <= 0)
+      return;
+    double log_q = std::log(1.0 - p);
+    for (uint64_t i = begin; i < end; i++) {
+      uint64_t j = i;
+      while (true) {
+        if (p >= 1)
+          j++;
+        else
+          j += 1 + (uint64_t)std::floor(std::log(1.0 - rng.real()) / log_q);
+        if (j >= n)
+          break;
+        out.emplace_back(i, j);
+      }
+    }
+  });
+  connect(n, chunks, seed);
+  return from_edges(n, chunks);
+}
+
+// A ring lattice where every node links to its k / 2 nearest nodes on each side,
+// then every link is rewired with probability beta to a random node that is neither
+// the node itself nor one of its lattice neighbours nor already drawn by it. Two
+// nodes can still draw each other, so repeats are dropped afterwards, and any part
+// the rewiring cut off is bridged back.
+inline Graph watts_strogatz(uint64_t n, uint64_t k, double beta, uint64_t seed) {
+  if (k < 2 || k % 2 != 0 || k >= n)
+    throw std::invalid_argument("small-world graphs need an even k with 2 <= k < n");
+  EdgeChunks chunks = chunked_edges(n, seed, [n, k, beta](Rand& rng, uint64_t begin, uint64_t end, std::vector<Edge>& out) {
+    std::vector<uint64_t> drawn;
+    for (uint64_t i = begin; i < end; i++) {
+      drawn.clear();
+      for (uint64_t d = 1; d <= k / 2; d++) {
+        uint64_t j = (i + d) % n;
+        // nodes that are not lattice neighbours and not drawn yet
+        if (rng.real() < beta && n - 1 - k > drawn.size()) {
+          while (true) {
+            j = rng.integer(n);
+            uint64_t distance = std::min((j + n - i) % n, (i + n - j) % n);
+            if (j != i && distance > k / 2 && std::find(drawn.begin(), drawn.end(), j) == drawn.end())
+              break;
+          }
+          drawn.push_back(j);
+        }
+        out.emplace_back(i, j);
+      }
+    }
+  });
+  connect(n, chunks, seed);
+  return simplify(from_edges(n, chunks));
+}
+
+// Preferential attachment: every new node links to m distinct existing nodes, picked
+// with probability proportional to their degree. Each step depends on all previous
+// ones, so this is the one generator that runs on a single thread.
+inline Graph barabasi_albert(uint64_t n, uint64_t m, uint64_t seed) {
+  if (m == 0)
+    throw std::invalid_argument("preferential attachment needs m >= 1");
+  EdgeChunks chunks(1);
+  std::vector<Edge>& out = chunks[0];
+  std::vector<uint64_t> ends;
+  uint64_t core = std::min(n, m + 1);
+  for (uint64_t i = 0; i < core; i++) {
+    for (uint64_t j = i + 1; j < core; j++) {
+      out.emplace_back(i, j);
+      ends.push_back(i);
+      ends.push_back(j);
+    }
+  }
+  Rand rng = stream(seed, 0);
+  std::unordered_set<uint64_t> targets;
+  for (uint64_t v = core; v < n; v++) {
+    targets.clear();
+    while (targets.size() < m)
+      targets.insert(ends[rng.integer(ends.size())]);
+    for (uint64_t t: targets) {
+      out.emplace_back(v, t);
+      ends.push_back(v);
+      ends.push_back(t);
+    }
+  }
+  return from_edges(n, chunks);
+}
+
+// A width x height grid with four neighbours per node, wrapping around when torus is set.
+inline Graph grid(uint64_t width, uint64_t height, bool torus) {
+  uint64_t n = width * height;
+  return from_edges(n, chunked_edges(n, 0, [=](Rand&, uint64_t begin, uint64_t end, std::vector<Edge>& out) {
+    for (uint64_t i = begin; i < end; i++) {
+      uint64_t x = i % width;
+      uint64_t y = i / width;
+      if (x + 1 < width)
+        out.emplace_back(i, i + 1);
+      else if (torus && width > 2)
+        out.emplace_back(i, y * width);
+      if (y + 1 < height)
+        out.emplace_back(i, i + width);
+      else if (torus && height > 2)
+        out.emplace_back(i, x);
+    }
+  }));
+}
+
+inline Graph hypercube(uint64_t dimensions) {
+  uint64_t n = uint64_t(1) << dimensions;
+  return from_edges(n, chunked_edges(n, 0, [=](Rand&, uint64_t begin, uint64_t end, std::vector<Edge>& out) {
+    for (uint64_t i = begin; i < end; i++) {
+      for (uint64_t b = 0; b < dimensions; b++) {
+        uint64_t j = i ^ (uint64_t(1) << b);
+        if (j > i)
+          out.emplace_back(i, j);
+      }
+    }
+  }));
+}
+
+// The graphs leader_arbitrary has always used: a path through every node plus
+// `extra` random edges between distinct nodes. A random edge can land on the path
+// or on another random edge, so repeats are dropped afterwards.
+inline Graph path_plus_random(uint64_t n, uint64_t extra, uint64_t seed) {
+  EdgeChunks chunks = chunked_edges(n, seed, [](Rand&, uint64_t begin, uint64_t end, std::vector<Edge>& out) {
+    for (uint64_t i = std::max<uint64_t>(begin, 1); i < end; i++)
+      out.emplace_back(i - 1, i);
+  });
+  if (n > 1) {
+    std::vector<Edge> random;
+    Rand rng = stream(seed, chunks.size());
+    while (random.size() < extra) {
+      uint64_t from = rng.integer(n);
+      uint64_t to = rng.integer(n);
+      if (from != to)
+        random.emplace_back(from, to);
+    }
+    chunks.push_back(std::move(random));
+  }
+  return simplify(from_edges(n, chunks));
+}
+
+// Command line description of a graph. `degree` is the branching factor of trees,
+// the average degree of Erdős–Rényi graphs, k for small-world graphs and m for
+// scale-free ones. Grids are as square as possible and hypercubes round the node
+// count up to a power of two, so check Graph::nodes() for the actual size.
+struct Spec {
+  std::string shape = "arbitrary";
+  uint64_t nodes = 100;
+  uint64_t degree = 4;
+  uint64_t extra_edges = 0;
+  double rewire = 0.1;
+  uint64_t seed = 123456;
+};
+
+inline Graph generate(const Spec & spec) {
+  uint64_t n = spec.nodes;
+  if (spec.shape == "arbitrary")
+    return path_plus_random(n, spec.extra_edges, spec.seed);
+  if (spec.shape == "ring")
+    return ring(n);
+  if (spec.shape == "kary")
+    return kary_tree(n, spec.degree);
+  if (spec.shape == "tree")
+    return random_tree(n, spec.degree, spec.seed);
+  if (spec.shape == "er")
+    return erdos_renyi(n, (double)spec.degree, spec.seed);
+  if (spec.shape == "ws")
+    return watts_strogatz(n, spec.degree, spec.rewire, spec.seed);
+  if (spec.shape == "ba")
+    return barabasi_albert(n, spec.degree, spec.seed);
+  if (spec.shape == "grid" || spec.shape == "torus") {
+    uint64_t width = std::max<uint64_t>(1, (uint64_t)std::sqrt((double)n));
+    return grid(width, (n + width - 1) / width, spec.shape == "torus");
+  }
+  if (spec.shape == "hypercube") {
+    uint64_t dimensions = 0;
+    while ((uint64_t(1) << dimensions) < n)
+      dimensions++;
+    return hypercube(dimensions);
+  }
+  throw std::invalid_argument("unknown topology: " + spec.shape);
+}
+
+};